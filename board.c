@@ -1,291 +1,1250 @@
+#ifdef BENCH
+#define _POSIX_C_SOURCE 199309L /* clock_gettime() */
+#include <time.h>
+#endif
+#include <assert.h>
 #include "board.h"
 
-<<<<<<< HEAD
-<<<<<<< HEAD
-#define AXIS 5 /* AXIS by AXIS board */
+#ifdef MORTON
+#if CHUNK_SHIFT != 3
+#error "spread() and compact() assume 8x8 chunks."
+#endif
+/* Z-order: x's bits take the odd places and y's the even ones, so cells
+ * near each other both ways tend to share a cache line. */
+#define X_BITS 0x2au
+#define Y_BITS 0x15u
 
-struct board {
-	struct tile tiles[AXIS*AXIS];
-	struct slot slot_spots[AXIS*AXIS];
-	unsigned int sps; /* # of open slot spots (placeable slots) */
-	char column_terminators[AXIS];
-};
+static unsigned int spread(unsigned int v)
+{
+	return (v & 1) | (v & 2) << 1 | (v & 4) << 2;
+}
 
-struct board make_board(void)
+static unsigned int compact(unsigned int v)
 {
-	struct board b;
-	enum edge edges[5] = { NONE, NONE, NONE, NONE, NONE };
-	const unsigned int mid = (AXIS - 1) / 2; /* Must start in center. */
-	b.slot_spots[0] = make_slot(mid, mid);
-	b.sps = 1;
-	for (unsigned int i = 0; i < AXIS*AXIS; ++i) {
-		b.tiles[i] = create_tile(edges);
+	return (v & 1) | (v & 4) >> 1 | (v & 16) >> 2;
+}
+
+/* Where s sits in its chunk. */
+static unsigned int local_index(struct slot s)
+{
+	return spread(s.x % CHUNK_SIDE) << 1 | spread(s.y % CHUNK_SIDE);
+}
+
+static struct slot local_slot(const struct chunk *c, unsigned int l)
+{
+	return make_slot(c->cx * CHUNK_SIDE + compact(l >> 1),
+		c->cy * CHUNK_SIDE + compact(l));
+}
+
+/* The index next to l on side i (up, right, down, left), CHUNK_CELLS if
+ * that's in another chunk. Setting the bits outside mask lets a carry
+ * (or borrow) run straight through them. */
+static unsigned int local_step(unsigned int l, int i)
+{
+	const unsigned int mask = i % 2 ? X_BITS : Y_BITS;
+	if (i < 2) {
+		if ((l & mask) == mask) {
+			return CHUNK_CELLS;
+		}
+		return (((l | ~mask) + 1) & mask) | (l & ~mask);
 	}
-	/* Tab between columns except for the last one, which newlines. */
-	memset(b.column_terminators, '\t', AXIS - 1);
-	b.column_terminators[AXIS - 1] = '\n';
-	return b;
+	if (!(l & mask)) {
+		return CHUNK_CELLS;
+	}
+	return (((l & mask) - 1) & mask) | (l & ~mask);
+}
+#else
+/* Where s sits in its chunk: row-major, x picks the row. */
+static unsigned int local_index(struct slot s)
+{
+	return s.x % CHUNK_SIDE * CHUNK_SIDE + s.y % CHUNK_SIDE;
 }
 
-=======
->>>>>>> origin/dev
-=======
->>>>>>> Nick495/dev
-static size_t index_slot(struct slot s)
+static struct slot local_slot(const struct chunk *c, unsigned int l)
 {
-	return AXIS * s.x + s.y;
+	return make_slot(c->cx * CHUNK_SIDE + l / CHUNK_SIDE,
+		c->cy * CHUNK_SIDE + l % CHUNK_SIDE);
 }
 
-<<<<<<< HEAD
-<<<<<<< HEAD
-void print_board(struct board b)
+/* The index next to l on side i (up, right, down, left), CHUNK_CELLS if
+ * that's in another chunk. */
+static unsigned int local_step(unsigned int l, int i)
 {
-	const size_t cnt = TILE_LINES;
-	const size_t len = TILE_LINE_LEN;
-	char res[(AXIS * AXIS) * (TILE_LEN - 1) + 1]; /* Null terminators */
-	char buf[TILE_LEN];
+	const unsigned int x = l / CHUNK_SIDE, y = l % CHUNK_SIDE;
+	switch (i) {
+	case 0:
+		return y == CHUNK_SIDE - 1 ? CHUNK_CELLS : l + 1;
+	case 1:
+		return x == CHUNK_SIDE - 1 ? CHUNK_CELLS : l + CHUNK_SIDE;
+	case 2:
+		return y == 0 ? CHUNK_CELLS : l - 1;
+	default:
+		return x == 0 ? CHUNK_CELLS : l - CHUNK_SIDE;
+	}
+}
+#endif /* MORTON */
 
-	/* Pretty print the board in NxN format. */
-	for (size_t i = 0; i < AXIS; ++i) {
-		for (size_t j = 0; j < AXIS; ++j) {
-			print_tile(b.tiles[index_slot(make_slot(i, j))], buf);
-			for (size_t k = 0; k < cnt; ++k) {
-				const size_t ind = ((i *cnt +k) *AXIS +j) *len;
-				buf[(k + 1) *len - 1] = b.column_terminators[j];
-				memcpy(&res[ind], &buf[len * k], len);
-			}
+static uint64_t cell_bit(struct slot s)
+{
+	return (uint64_t) 1 << local_index(s);
+}
+
+static size_t chunk_hash(unsigned int cx, unsigned int cy)
+{
+	uint32_t h = cx * 0x9e3779b1u + cy;
+	h ^= h >> 15;
+	h *= 0x85ebca77u;
+	return h ^ h >> 13;
+}
+
+/* Where chunk (cx, cy) is in b's table, or the empty spot it would go. */
+static size_t chunk_bucket(const struct board *b, unsigned int cx,
+		unsigned int cy)
+{
+	const size_t mask = b->chunk_cap - 1;
+	size_t i = chunk_hash(cx, cy) & mask;
+	for (; b->chunks[i]; i = (i + 1) & mask) {
+		if (b->chunks[i]->cx == cx && b->chunks[i]->cy == cy) {
+			break;
 		}
 	}
-	res[(AXIS * AXIS) * (TILE_LEN - 1)] = '\0';
-	printf("%s\n\n", res);
+	return i;
 }
 
-=======
->>>>>>> origin/dev
-=======
->>>>>>> Nick495/dev
-static int slot_placeable(struct board b, struct slot s)
+/* The chunk holding s, or NULL if nothing was ever near s. */
+static struct chunk *find_chunk(const struct board *b, struct slot s)
 {
-	/* TODO: Switch to linear search? */
-	/* Linear search open positions for the desired one. */
-	for (unsigned i = 0; i < b.sps; ++i) {
-		switch(compare_slots(b.slot_spots[i], s)) {
-		case -1:
-			continue;
-		case 0:
-			return i + 1;
-		case 1:
-			return 0;
+	return b->chunks[chunk_bucket(b, s.x / CHUNK_SIDE, s.y / CHUNK_SIDE)];
+}
+
+static int grow_chunks(struct board *b)
+{
+	struct chunk **old = b->chunks;
+	const size_t cap = b->chunk_cap;
+	struct chunk **chunks = calloc(2 * cap, sizeof(*chunks));
+	if (!chunks) {
+		return 1;
+	}
+	b->chunks = chunks;
+	b->chunk_cap = 2 * cap;
+	for (size_t i = 0; i < cap; ++i) {
+		if (old[i]) {
+			struct chunk *c = old[i];
+			b->chunks[chunk_bucket(b, c->cx, c->cy)] = c;
 		}
 	}
+	free(old);
 	return 0;
 }
 
-static int slot_empty(struct board b, struct slot s)
+static void drop_chunk(struct chunk *c)
 {
-	struct tile t = b.tiles[index_slot(s)];
-	for (int i = 0; i < 5; ++i) {
-		if (t.edges[i] != EMPTY) {
-			return 0;
+	if (c && !__atomic_sub_fetch(&c->refs, 1, __ATOMIC_ACQ_REL)) {
+		free(c);
+	}
+}
+
+/* The chunk in bucket i, copied first if another board shares it. */
+static struct chunk *own_chunk(struct board *b, size_t i)
+{
+	struct chunk *c = b->chunks[i];
+	if (__atomic_load_n(&c->refs, __ATOMIC_ACQUIRE) == 1) {
+		return c;
+	}
+	struct chunk *copy = malloc(sizeof(*copy));
+	if (!copy) {
+		return NULL;
+	}
+	*copy = *c;
+	copy->refs = 1;
+	drop_chunk(c);
+	b->chunks[i] = copy;
+	return copy;
+}
+
+/* Like find_chunk(), but makes the chunk if need be, and takes a copy of
+ * its own if it's shared, so it's safe to write. NULL if out of memory.*/
+static struct chunk *get_chunk(struct board *b, struct slot s)
+{
+	const unsigned int cx = s.x / CHUNK_SIDE, cy = s.y / CHUNK_SIDE;
+	size_t i = chunk_bucket(b, cx, cy);
+	if (b->chunks[i]) {
+		return own_chunk(b, i);
+	}
+	/* Stay at most half full so probes stay short. */
+	if (2 * (b->chunk_count + 1) > b->chunk_cap) {
+		if (grow_chunks(b)) {
+			return NULL;
 		}
+		i = chunk_bucket(b, cx, cy);
 	}
-	return 1;
+	struct chunk *c = calloc(1, sizeof(*c));
+	if (!c) {
+		return NULL;
+	}
+	c->cx = cx;
+	c->cy = cy;
+	c->refs = 1;
+	b->chunks[i] = c;
+	b->chunk_count++;
+	return c;
 }
 
-static int slot_on_board(struct slot s)
+/* Makes room for n members. Positions have to stay below NIL. */
+static int frontier_reserve(struct frontier *f, size_t n)
 {
-	if (s.x < AXIS && s.y < AXIS) {
+	if (n <= f->cap) {
+		return 0;
+	}
+	if (n > NIL) {
 		return 1;
 	}
+	size_t cap = f->cap ? f->cap : 16;
+	while (cap < n) {
+		cap *= 2;
+	}
+	cap = cap > NIL ? NIL : cap;
+	struct slot *cells = realloc(f->cells, cap * sizeof(*cells));
+	if (!cells) {
+		return 1;
+	}
+	f->cells = cells;
+	uint8_t *sig = realloc(f->sig, cap * sizeof(*sig));
+	if (!sig) {
+		return 1;
+	}
+	f->sig = sig;
+	uint16_t *next = realloc(f->next, cap * sizeof(*next));
+	if (!next) {
+		return 1;
+	}
+	f->next = next;
+	uint16_t *prev = realloc(f->prev, cap * sizeof(*prev));
+	if (!prev) {
+		return 1;
+	}
+	f->prev = prev;
+	f->cap = cap;
 	return 0;
 }
 
-size_t find_spot(struct slot *slots, size_t count, struct slot s)
+static int frontier_has(const struct board *b, struct slot s)
 {
-	size_t i;
-	for (i = 0; i < count && compare_slots(s, slots[i]) > 0; ++i) {}
-	return i;
+	const struct chunk *c = find_chunk(b, s);
+	return c && (c->open & cell_bit(s));
 }
 
-static struct board add_placeable_slot(struct board b, struct slot s)
+/* Where open slot s sits in the frontier. */
+static uint16_t *frontier_pos(const struct board *b, struct slot s)
 {
-	struct slot *spots = b.slot_spots;
-	size_t i = find_spot(spots, b.sps, s);
-	if (i < b.sps) { /* Make room for the element (Sorted insert). */
-		memmove(&b.slot_spots[i + 1], &spots[i], sizeof(s) * b.sps - i);
+	return &find_chunk(b, s)->pos[local_index(s)];
+}
+/* Links position p into chain sig after position prev (NIL for the head). */
+static void chain_link(struct frontier *f, unsigned int p, unsigned int sig,
+		unsigned int prev)
+{
+	const unsigned int next = prev == NIL ? f->heads[sig] : f->next[prev];
+	f->sig[p] = sig;
+	f->prev[p] = prev;
+	f->next[p] = next;
+	if (prev == NIL) {
+		f->heads[sig] = p;
+	} else {
+		f->next[prev] = p;
+	}
+	if (next != NIL) {
+		f->prev[next] = p;
 	}
-	spots[i] = s;
-	b.sps++;
-	return b;
 }
 
-static struct board remove_placeable_slot(struct board b, struct slot s)
+/* Unlinks position p from its chain. Returns what came before it. */
+static unsigned int chain_unlink(struct frontier *f, unsigned int p)
 {
-	struct slot *spots = b.slot_spots;
-	size_t i = find_spot(spots, b.sps, s);
-	memmove(&spots[i], &spots[i + 1], sizeof(s) * (b.sps-- - i));
-	return b;
+	const unsigned int prev = f->prev[p], next = f->next[p];
+	if (prev == NIL) {
+		f->heads[f->sig[p]] = next;
+	} else {
+		f->next[prev] = next;
+	}
+	if (next != NIL) {
+		f->prev[next] = prev;
+	}
+	return prev;
 }
 
-static struct board update_slot_spots(struct board b, struct slot s)
+/* Hands position from's place in its chain over to position to. */
+static void chain_move(struct frontier *f, unsigned int from, unsigned int to)
 {
-	/* Check the slots above, left, right, and below. */
-	struct slot adj[4] = { 
-		make_slot(s.x, s.y - 1), make_slot(s.x - 1, s.y),
-		make_slot(s.x + 1, s.y), make_slot(s.x, s.y + 1)
-	};
-	b = remove_placeable_slot(b, s);
-	for (int i = 0; i < 4; ++i) {
-		if (slot_empty(b, adj[i]) && slot_on_board(adj[i])) {
-			b = add_placeable_slot(b, adj[i]);
+	f->sig[to] = f->sig[from];
+	f->prev[to] = f->prev[from];
+	f->next[to] = f->next[from];
+	if (f->prev[to] == NIL) {
+		f->heads[f->sig[to]] = to;
+	} else {
+		f->next[f->prev[to]] = to;
+	}
+	if (f->next[to] != NIL) {
+		f->prev[f->next[to]] = to;
+	}
+}
+
+static void frontier_add(struct board *b, struct slot s, unsigned int sig)
+{
+	struct frontier *f = &b->frontier;
+	assert(f->count < f->cap);
+	const unsigned int p = f->count++;
+	find_chunk(b, s)->open |= cell_bit(s);
+	*frontier_pos(b, s) = p;
+	f->cells[p] = s;
+	chain_link(f, p, sig, NIL);
+}
+
+/* Swaps the last member into s's place. Returns where s was; prev gets
+ * what came before it in its chain. */
+static unsigned int frontier_remove(struct board *b, struct slot s,
+		unsigned int *prev)
+{
+	struct frontier *f = &b->frontier;
+	const unsigned int p = *frontier_pos(b, s);
+	const unsigned int last = --f->count;
+	find_chunk(b, s)->open &= ~cell_bit(s);
+	*prev = chain_unlink(f, p);
+	if (p != last) {
+		f->cells[p] = f->cells[last];
+		*frontier_pos(b, f->cells[p]) = p;
+		chain_move(f, last, p);
+	}
+	return p;
+}
+
+/* Inverse of frontier_remove(): puts s back at p, after prev in chain sig.*/
+static void frontier_restore(struct board *b, struct slot s, unsigned int p,
+		unsigned int sig, unsigned int prev)
+{
+	struct frontier *f = &b->frontier;
+	if (p < f->count) {
+		f->cells[f->count] = f->cells[p];
+		*frontier_pos(b, f->cells[p]) = f->count;
+		chain_move(f, p, f->count);
+	}
+	f->count++;
+	find_chunk(b, s)->open |= cell_bit(s);
+	*frontier_pos(b, s) = p;
+	f->cells[p] = s;
+	chain_link(f, p, sig, prev);
+}
+
+static int slot_on_board(const struct board *b, struct slot s)
+{
+	if (s.x < b->axis && s.y < b->axis) {
+		return 1;
+	}
+	return 0;
+}
+
+static int slot_placeable(const struct board *b, struct slot s)
+{
+	return slot_on_board(b, s) && frontier_has(b, s);
+}
+
+/* The id of the tile at s, 0 if there isn't one. */
+unsigned int board_tile(const struct board *b, struct slot s)
+{
+	const struct chunk *c = find_chunk(b, s);
+	return c ? c->tiles[local_index(s)] : 0;
+}
+
+/* How many tiles were placed before the one at s, which mustn't be empty.
+ * Unplaying keeps this a dense index over the tiles on the board. */
+size_t board_order(const struct board *b, struct slot s)
+{
+	return find_chunk(b, s)->order[local_index(s)];
+}
+
+/* Writes the slots of b's tiles to out, which must hold b->tile_count
+ * slots, in the order they were placed. */
+void board_placed(const struct board *b, struct slot *out)
+{
+	for (size_t i = 0; i < b->chunk_cap; ++i) {
+		const struct chunk *c = b->chunks[i];
+		for (unsigned int l = 0; c && l < CHUNK_CELLS; ++l) {
+			if (c->tiles[l]) {
+				out[c->order[l]] = local_slot(c, l);
+			}
 		}
 	}
-	return b;
 }
 
-<<<<<<< HEAD
-<<<<<<< HEAD
-struct move {
-	struct tile tile;
-	struct slot slot;
-	int rotation;
+/* Tiles in the 8 cells around the tile at s, which mustn't be empty. 8
+ * means it's surrounded, which is all a monastery waits on. */
+unsigned int board_around(const struct board *b, struct slot s)
+{
+	return find_chunk(b, s)->around[local_index(s)];
+}
+
+/* Fills adj with the slots up, right, down and left of s, in the same
+ * order as a tile's edges. Off board slots wrap and fail slot_on_board. */
+static void adjacent_slots(struct slot s, struct slot adj[4])
+{
+	adj[0] = make_slot(s.x, s.y + 1);	/* up */
+	adj[1] = make_slot(s.x + 1, s.y);	/* right */
+	adj[2] = make_slot(s.x, s.y - 1);	/* down */
+	adj[3] = make_slot(s.x - 1, s.y);	/* left */
+}
+
+/* A cell as the chunk it's in and where it sits there. */
+struct cell {
+	struct chunk *c;
+	unsigned int l;
 };
 
-struct move make_move(struct tile t, struct slot s, int rotation)
+/* Fills adj like adjacent_slots(), and cells with where they are. Steps
+ * that stay in s's chunk skip the hash table. Off board neighbours, and
+ * ones no chunk holds yet, get a NULL chunk. */
+static void adjacent_cells(const struct board *b, struct slot s,
+		struct slot adj[4], struct cell cells[4])
 {
-	struct move m = {
-		.tile = t,
-		.slot = s,
-		.rotation = rotation
-	};
-	return m;
+	struct chunk *c = find_chunk(b, s);
+	const unsigned int l = local_index(s);
+	adjacent_slots(s, adj);
+	for (int i = 0; i < 4; ++i) {
+		cells[i].c = c;
+		cells[i].l = local_step(l, i);
+		if (!slot_on_board(b, adj[i])) {
+			cells[i].c = NULL;
+		} else if (cells[i].l == CHUNK_CELLS) {
+			cells[i].c = find_chunk(b, adj[i]);
+			cells[i].l = local_index(adj[i]);
+		}
+	}
+}
+
+/* The 8 cells around a slot: up right then clockwise. */
+static const int around_dx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int around_dy[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+/* Adds d to the counts of the tiles around s, and returns how many there
+ * are. Cells in s's chunk skip the hash table. */
+static unsigned int count_around(struct board *b, struct slot s, int d)
+{
+	struct chunk *const home = find_chunk(b, s);
+	unsigned int n = 0;
+	for (int i = 0; i < 8; ++i) {
+		const struct slot t = make_slot(s.x + around_dx[i],
+			s.y + around_dy[i]);
+		struct chunk *c = home;
+		if (!slot_on_board(b, t)) {
+			continue;
+		}
+		if (t.x / CHUNK_SIDE != home->cx ||
+				t.y / CHUNK_SIDE != home->cy) {
+			c = find_chunk(b, t);
+		}
+		const unsigned int l = local_index(t);
+		if (c && c->tiles[l]) {
+			c->around[l] += d;
+			n++;
+		}
+	}
+	return n;
+}
+
+/* Sets (or clears) the edge plane bits the tile at s shows its neighbours.
+ * A neighbour sees our edge i from its own side (i + 2) % 4. */
+static void mark_edges(struct board *b, struct slot s, unsigned int id, int on)
+{
+	struct slot adj[4];
+	struct cell n[4];
+	adjacent_cells(b, s, adj, n);
+	const uint16_t t = id_packed(id);
+	for (int i = 0; i < 4; ++i) {
+		if (!n[i].c) {
+			continue;
+		}
+		const uint64_t bit = (uint64_t) 1 << n[i].l;
+		uint64_t *p = n[i].c->edges[(i + 2) % 4];
+		uint64_t *w = &p[PACKED_EDGE(t, i) - 1];
+		*w = on ? *w | bit : *w & ~bit;
+	}
+}
+
+/* The cells of c where packed tile t would meet a different edge. Only
+ * one plane per side can be set, so anything outside t's own edge's
+ * plane is a mismatch. Empty neighbours set no planes and match anything.*/
+static uint64_t edge_conflicts(const struct chunk *c, uint16_t t)
+{
+	uint64_t bad = 0;
+	for (int i = 0; i < 4; ++i) {
+		const uint64_t *p = c->edges[i];
+		bad |= (p[0] | p[1] | p[2]) & ~p[PACKED_EDGE(t, i) - 1];
+	}
+	return bad;
+}
+
+/* The edges cell l of c's neighbours show it, packed like a tile's sides.*/
+static unsigned int cell_signature(const struct chunk *c, unsigned int l)
+{
+	unsigned int sig = 0;
+	for (int d = 0; d < 4; ++d) {
+		for (unsigned int e = 0; e < 3; ++e) {
+			const uint64_t bit = (c->edges[d][e] >> l) & 1;
+			sig |= bit * (e + 1) << (2 * d);
+		}
+	}
+	return sig;
+}
+
+/* Closes s and opens its empty neighbours, moving the ones that were
+ * already open to the chain for their new signature. Call after
+ * mark_edges(). Fills in u's frontier fields. */
+static void update_slot_spots(struct board *b, struct slot s,
+		struct board_undo *u)
+{
+	struct frontier *f = &b->frontier;
+	struct slot adj[4];
+	struct cell n[4];
+	unsigned int prev;
+	adjacent_cells(b, s, adj, n);
+	u->sig = f->sig[*frontier_pos(b, s)];
+	u->pos = frontier_remove(b, s, &prev);
+	u->prev[0] = prev;
+	u->added = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (!n[i].c || n[i].c->tiles[n[i].l]) {
+			continue;
+		}
+		const unsigned int sig = cell_signature(n[i].c, n[i].l);
+		if ((n[i].c->open >> n[i].l) & 1) {
+			const unsigned int p = n[i].c->pos[n[i].l];
+			u->prev[i + 1] = chain_unlink(f, p);
+			chain_link(f, p, sig, NIL);
+		} else {
+			frontier_add(b, adj[i], sig);
+			u->added |= 1 << i;
+		}
+	}
+}
+
+/* Inverse of update_slot_spots(). Call before clearing s's edges. */
+static void restore_slot_spots(struct board *b, struct board_undo u)
+{
+	struct frontier *f = &b->frontier;
+	struct slot adj[4];
+	struct cell n[4];
+	unsigned int prev;
+	adjacent_cells(b, u.slot, adj, n);
+	/* Undo in reverse: later links sit on top of earlier ones. */
+	for (int i = 3; i >= 0; --i) {
+		if (!n[i].c || n[i].c->tiles[n[i].l]) {
+			continue;
+		}
+		if (u.added & 1 << i) {
+			frontier_remove(b, adj[i], &prev);
+		} else {
+			/* Our edge is the only change to its signature. */
+			const unsigned int p = n[i].c->pos[n[i].l];
+			const unsigned int side = 3u << (2 * ((i + 2) % 4));
+			chain_unlink(f, p);
+			chain_link(f, p, f->sig[p] & ~side, u.prev[i + 1]);
+		}
+	}
+	frontier_restore(b, u.slot, u.pos, u.sig, u.prev[0]);
 }
 
-static int validate_move(struct board b, struct move m)
-=======
-/* TODO: Switch int error codes to error enums for cleanliness. */
-static int invalid_move(struct board b, struct move m)
->>>>>>> origin/dev
-=======
 /* TODO: Switch int error codes to error enums for cleanliness. */
-static int invalid_move(struct board b, struct move m)
->>>>>>> Nick495/dev
+static int invalid_move(const struct board *b, struct slot s, unsigned int id)
 {
-	if (!slot_placeable(b, m.slot)) {
+	if (!id) {
+		return 3; /* Not a tile from the catalog. */
+	}
+	if (!slot_placeable(b, s)) {
 		return 1; /* Slot not placeable. */
 	}
-	/* Check adjacent tiles to make sure edges match. */
-	struct slot adj[4] = {
-		make_slot(m.slot.x, m.slot.y + 1),	/* up */
-		make_slot(m.slot.x + 1, m.slot.y),	/* right */
-		make_slot(m.slot.x, m.slot.y - 1),	/* down */
-		make_slot(m.slot.x - 1, m.slot.y)	/* left*/
-	};
-	for (unsigned int i = 0; i < sizeof(adj); ++i) { /* Need wrapping */
-		if (!slot_on_board(adj[i])) { /* ignore if not on board. */
+	if (edge_conflicts(find_chunk(b, s), id_packed(id)) & cell_bit(s)) {
+		return 2; /* Corresponding edges don't match. */
+	}
+	return 0;
+}
+
+/* Makes sure every chunk a move at s writes is the board's own: s's,
+ * its neighbours', the ones holding tiles around it, and moved's, the
+ * frontier member that gets shuffled into a new place (if any). */
+static int own_chunks(struct board *b, struct slot s, const struct slot *moved)
+{
+	struct slot adj[4];
+	adjacent_slots(s, adj);
+	if (!get_chunk(b, s) || (moved && !get_chunk(b, *moved))) {
+		return 4; /* Out of memory. */
+	}
+	for (int i = 0; i < 4; ++i) {
+		if (slot_on_board(b, adj[i]) && !get_chunk(b, adj[i])) {
+			return 4;
+		}
+	}
+	/* Corners only matter with a tile in, and then have a chunk. */
+	for (int i = 1; i < 8; i += 2) {
+		const struct slot t = make_slot(s.x + around_dx[i],
+			s.y + around_dy[i]);
+		if (slot_on_board(b, t) && board_tile(b, t) &&
+				!get_chunk(b, t)) {
+			return 4;
+		}
+	}
+	return 0;
+}
+
+/* Gets the memory a move at s could need up front, so playing it can't
+ * fail halfway through. */
+static int reserve_move(struct board *b, struct slot s)
+{
+	struct frontier *f = &b->frontier;
+	/* s leaves and at most 4 neighbours join. */
+	if (frontier_reserve(f, f->count + 3)) {
+		return 4; /* Out of memory. */
+	}
+	/* The last member takes s's place. */
+	return own_chunks(b, s, &f->cells[f->count - 1]);
+}
+
+/* Writes the placeable slots that tile id fits in to out, which must hold
+ * b->frontier.count slots, and returns how many there are. */
+size_t fitting_slots(const struct board *b, unsigned int id, struct slot *out)
+{
+	const uint16_t t = id_packed(id);
+	size_t n = 0;
+	for (size_t i = 0; i < b->chunk_cap; ++i) {
+		const struct chunk *c = b->chunks[i];
+		if (!c || !c->open) {
 			continue;
 		}
-		/* The (i + 2) % 4 math here is a bit evil, but it works. */
-		enum edge pair = b.tiles[index_slot(adj[i])].edges[(i + 2) % 4];
-<<<<<<< HEAD
-<<<<<<< HEAD
-		if (pair == NONE) {
-=======
-		if (pair == EMPTY) {
->>>>>>> origin/dev
-=======
-		if (pair == EMPTY) {
->>>>>>> Nick495/dev
-			continue; /* Empty tiles match with everything. */
-		}
-		if (pair != m.tile.edges[i]) { /* Corresponding don't match. */
-			return 2;
-<<<<<<< HEAD
-=======
+		uint64_t fits = c->open & ~edge_conflicts(c, t);
+		for (; fits; fits &= fits - 1) {
+			out[n++] = local_slot(c, __builtin_ctzll(fits));
 		}
 	}
+	return n;
+}
+
+/* Writes every legal (slot, rotation) for t to out, which must hold
+ * 4 * b->frontier.count moves (MOVES_MAX does for a TILE_COUNT deck), and
+ * returns how many there are. Rotations that give the same tile are only
+ * listed once. A tile fits exactly the signatures made of some subset of
+ * its own sides, so this walks at most 16 chains per rotation instead of
+ * the whole frontier. */
+size_t generate_moves(const struct board *b, struct tile t, struct move *out)
+{
+	const struct frontier *f = &b->frontier;
+	const unsigned int id = tile_to_id(t);
+	size_t n = 0;
+	if (!id) {
+		return 0;
+	}
+	for (int r = 0; r < 4; ++r) {
+		if (r && rotate_id(id, r) == id) {
+			break; /* Symmetric: the rest repeat the first few. */
+		}
+		const unsigned int sides = id_packed(rotate_id(id, r)) & 0xff;
+		for (unsigned int m = 0; m < 16; ++m) {
+			const unsigned int keep = (m & 1) * 3 | (m & 2) * 6
+				| (m & 4) * 12 | (m & 8) * 24;
+			unsigned int p = f->heads[sides & keep];
+			for (; p != NIL; p = f->next[p]) {
+				out[n++] = make_move(t, f->cells[p], r);
+			}
+		}
+	}
+	return n;
+}
+
+/* A well spread 64 bit value for each x, the splitmix64 finalizer. */
+uint64_t hash_mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	return x ^ x >> 31;
+}
+
+/* The Zobrist key for tile id at offset (dx, dy) from the start slot.
+ * Keys are made on the fly rather than looked up, and are relative to
+ * the start, so boards of any axis agree on them. */
+static uint64_t tile_key(int32_t dx, int32_t dy, unsigned int id)
+{
+	const uint64_t at = (uint64_t) (uint32_t) dx << 32 | (uint32_t) dy;
+	return hash_mix(hash_mix(at) ^ id);
+}
+
+/* Moves offset (dx, dy) by symmetry k: mirrored left to right if k & 4,
+ * then turned a quarter clockwise k & 3 times, about the start slot. */
+static void transform_offset(int32_t *dx, int32_t *dy, int k)
+{
+	if (k & 4) {
+		*dx = -*dx;
+	}
+	for (int r = 0; r < (k & 3); ++r) {
+		const int32_t x = *dx;
+		*dx = *dy;
+		*dy = -x;
+	}
+}
+
+/* XORs tile id at s in or out of every symmetry's hash. */
+static void toggle_hashes(struct board *b, struct slot s, unsigned int id)
+{
+	const unsigned int mid = (b->axis - 1) / 2;
+	for (int k = 0; k < SYMMETRIES; ++k) {
+		int32_t dx = (int32_t) (s.x - mid), dy = (int32_t) (s.y - mid);
+		transform_offset(&dx, &dy, k);
+		b->hashes[k] ^= tile_key(dx, dy, transform_id(id, k));
+	}
+}
+
+/* Where s goes when the board is moved by symmetry k. */
+struct slot transform_slot(const struct board *b, struct slot s, int k)
+{
+	const unsigned int mid = (b->axis - 1) / 2;
+	int32_t dx = (int32_t) (s.x - mid), dy = (int32_t) (s.y - mid);
+	transform_offset(&dx, &dy, k);
+	return make_slot(mid + dx, mid + dy);
+}
+
+/* The symmetry that takes b to its canonical orientation: the one with
+ * the least hash, the lowest k on a tie. Boards that are rotations or
+ * reflections of each other share canonical_hash(). */
+int canonical_symmetry(const struct board *b)
+{
+	int best = 0;
+	for (int k = 1; k < SYMMETRIES; ++k) {
+		if (b->hashes[k] < b->hashes[best]) {
+			best = k;
+		}
+	}
+	return best;
+}
+
+uint64_t canonical_hash(const struct board *b)
+{
+	return b->hashes[canonical_symmetry(b)];
+}
+
+/* Whether any tile in the catalog could still go in s. */
+int slot_fillable(const struct board *b, struct slot s)
+{
+	size_t n;
+	if (!slot_placeable(b, s)) {
+		return 0;
+	}
+	signature_fits(b->frontier.sig[*frontier_pos(b, s)], &n);
+	return n > 0;
+}
+
+/* Tells b there are n more tiles of kind left to come, or fewer if n is
+ * negative. Games call this as they build and deal their decks. */
+void board_add_tiles(struct board *b, unsigned int kind, int n)
+{
+	size_t count;
+	const uint8_t *sigs = kind_signatures(kind, &count);
+	for (size_t i = 0; i < count; ++i) {
+		b->fills[sigs[i]] += n;
+	}
+	b->deck += n;
+}
+
+/* board_add_tiles() for every kind_count() of every kind: a whole deck,
+ * from a table made once. */
+void board_add_deck(struct board *b)
+{
+	const uint16_t *fills = deck_fills();
+	for (unsigned int sig = 0; sig < SIGNATURES; ++sig) {
+		b->fills[sig] += fills[sig];
+	}
+	b->deck += TILE_COUNT;
+}
+
+/* How many of the tiles left to come fit open slot s, some way round. */
+unsigned int slot_fills(const struct board *b, struct slot s)
+{
+	return b->fills[b->frontier.sig[*frontier_pos(b, s)]];
+}
+
+/* The chance the next tile dealt fits open slot s. */
+double fill_probability(const struct board *b, struct slot s)
+{
+	return b->deck ? (double) slot_fills(b, s) / b->deck : 0;
+}
+
+/* Writes the open slots none of the tiles left fit to out, which must
+ * hold b->frontier.count slots, and returns how many there are. They'll
+ * never be filled, so whatever they cut off stays open. */
+size_t dead_slots(const struct board *b, struct slot *out)
+{
+	const struct frontier *f = &b->frontier;
+	size_t n = 0;
+	for (unsigned int sig = 0; sig < SIGNATURES; ++sig) {
+		if (b->fills[sig]) {
+			continue;
+		}
+		for (unsigned int p = f->heads[sig]; p != NIL; p = f->next[p]) {
+			out[n++] = f->cells[p];
+		}
+	}
+	return n;
+}
+
+/* Makes an empty axis by axis board. Returns nonzero if out of memory. */
+int make_board(struct board *b, unsigned int axis)
+{
+	const struct slot mid = make_slot((axis - 1) / 2, (axis - 1) / 2);
+	/* Empty is all zeros, in chunks (EMPTY) and in counts and hashes. */
+	memset(b, 0, sizeof(*b));
+	b->axis = axis;
+	b->chunk_cap = 8;
+	b->chunks = calloc(b->chunk_cap, sizeof(*b->chunks));
+	memset(b->frontier.heads, 0xff, sizeof(b->frontier.heads)); /* NIL */
+	if (!b->chunks || !get_chunk(b, mid) ||
+			frontier_reserve(&b->frontier, 16)) {
+		free_board(b);
+		return 1;
+	}
+	frontier_add(b, mid, 0); /* Must start in center. */
+	return 0;
+}
+
+/* Makes dst a copy of src that shares src's chunks until either writes
+ * to one. Forks are independent boards, with the same API: play, unplay
+ * and free_board() them as usual. Only the chunk table and the frontier
+ * (a few hundred bytes each for a TILE_COUNT game) are copied up front.
+ * Returns nonzero if out of memory. */
+int board_fork(struct board *dst, const struct board *src)
+{
+	const struct frontier *f = &src->frontier;
+	struct frontier *g = &dst->frontier;
+	*dst = *src;
+	dst->chunks = malloc(src->chunk_cap * sizeof(*dst->chunks));
+	g->cells = malloc(f->cap * sizeof(*f->cells));
+	g->sig = malloc(f->cap * sizeof(*f->sig));
+	g->next = malloc(f->cap * sizeof(*f->next));
+	g->prev = malloc(f->cap * sizeof(*f->prev));
+	if (!dst->chunks || !g->cells || !g->sig || !g->next || !g->prev) {
+		free(dst->chunks);
+		dst->chunks = NULL;
+		free_board(dst);
+		return 1;
+	}
+	for (size_t i = 0; i < src->chunk_cap; ++i) {
+		dst->chunks[i] = src->chunks[i];
+		if (dst->chunks[i]) {
+			__atomic_add_fetch(&dst->chunks[i]->refs, 1,
+				__ATOMIC_RELAXED);
+		}
+	}
+	memcpy(g->cells, f->cells, f->count * sizeof(*f->cells));
+	memcpy(g->sig, f->sig, f->count * sizeof(*f->sig));
+	memcpy(g->next, f->next, f->count * sizeof(*f->next));
+	memcpy(g->prev, f->prev, f->count * sizeof(*f->prev));
 	return 0;
 }
 
-struct board make_board(void)
+void free_board(struct board *b)
 {
-       struct board b;
-       enum edge edges[5] = { EMPTY, EMPTY, EMPTY, EMPTY, EMPTY };
-       const unsigned int mid = (AXIS - 1) / 2; /* Must start in center. */
-       b.slot_spots[0] = make_slot(mid, mid);
-       b.sps = 1;
-       for (unsigned int i = 0; i < AXIS*AXIS; ++i) {
-		b.tiles[i] = make_tile(edges, NONE);
-       }
-       /* Tab between columns except for the last one, which newlines. */
-       memset(b.column_terminators, '\t', AXIS - 1);
-       b.column_terminators[AXIS - 1] = '\n';
-       return b;
+	for (size_t i = 0; b->chunks && i < b->chunk_cap; ++i) {
+		drop_chunk(b->chunks[i]);
+	}
+	free(b->chunks);
+	free(b->frontier.cells);
+	free(b->frontier.sig);
+	free(b->frontier.next);
+	free(b->frontier.prev);
+	b->chunks = NULL;
+	b->chunk_cap = b->chunk_count = 0;
+	memset(&b->frontier, 0, sizeof(b->frontier));
+}
+
+/* How big text for the slots in box is, row by row. */
+static size_t box_len(struct box box)
+{
+	if (box.x0 > box.x1) {
+		return 1; /* Nothing in it. */
+	}
+	const size_t rows = box.x1 - box.x0 + 1, cols = box.y1 - box.y0 + 1;
+	return rows * cols * (TILE_LEN - 1) + 1;
 }
 
-char *print_board(struct board b, char res[BOARD_LEN])
+/* Draws tile id at s into res, text for the slots in box. Tab between
+ * columns, the last one newlines. */
+static void draw_cell(char *res, struct box box, struct slot s,
+		unsigned int id)
 {
-	const size_t cnt = TILE_LINES;
 	const size_t len = TILE_LINE_LEN;
+	const size_t cols = box.y1 - box.y0 + 1;
+	const size_t i = s.x - box.x0, j = s.y - box.y0;
+	const char end = s.y < box.y1 ? '\t' : '\n';
 	char buf[TILE_LEN];
+	print_tile(id_to_tile(id), buf);
+	for (size_t k = 0; k < TILE_LINES; ++k) {
+		const size_t ind = ((i * TILE_LINES + k) * cols + j) * len;
+		buf[(k + 1) * len - 1] = end;
+		memcpy(&res[ind], &buf[len * k], len);
+	}
+}
 
-	/* Pretty print the board in NxN format. */
-	for (size_t i = 0; i < AXIS; ++i) {
-		for (size_t j = 0; j < AXIS; ++j) {
-			print_tile(b.tiles[index_slot(make_slot(i, j))], buf);
-			for (size_t k = 0; k < cnt; ++k) {
-				const size_t ind = ((i *cnt +k) *AXIS +j) *len;
-				buf[(k + 1) *len - 1] = b.column_terminators[j];
-				memcpy(&res[ind], &buf[len * k], len);
-			}
->>>>>>> Nick495/dev
+static char *print_box(const struct board *b, struct box box, char *res)
+{
+	for (unsigned int x = box.x0; x <= box.x1; ++x) {
+		for (unsigned int y = box.y0; y <= box.y1; ++y) {
+			const struct slot s = make_slot(x, y);
+			draw_cell(res, box, s, board_tile(b, s));
 		}
 	}
-	res[BOARD_LEN - 1] = '\0';
+	res[box_len(box) - 1] = '\0';
 	return res;
 }
 
-/* See TODO for invalid_move. */
-int play_move_board(struct board *b, struct move m)
+/* The tiles' bounding box, or an empty one (x0 > x1) with no tiles. */
+static struct box tile_box(const struct board *b)
+{
+	const struct box none = { 1, 1, 0, 0 };
+	return b->tile_count ? b->box : none;
+}
+
+/* How big print_board()'s buffer has to be. */
+size_t board_len(const struct board *b)
+{
+	const struct box all = { 0, 0, b->axis - 1, b->axis - 1 };
+	return box_len(all);
+}
+
+/* Pretty prints the whole board in NxN format. */
+char *print_board(const struct board *b, char *res)
+{
+	const struct box all = { 0, 0, b->axis - 1, b->axis - 1 };
+	return print_box(b, all, res);
+}
+
+/* How big print_cropped()'s buffer has to be. */
+size_t cropped_len(const struct board *b)
+{
+	return box_len(tile_box(b));
+}
+
+/* Like print_board(), but only the slots in the tiles' bounding box. */
+char *print_cropped(const struct board *b, char *res)
+{
+	return print_box(b, tile_box(b), res);
+}
+
+/* Makes an empty view. The first update_view() draws it all. */
+void make_view(struct board_view *v)
+{
+	const struct box none = { 1, 1, 0, 0 };
+	v->box = none;
+	v->epoch = 0;
+	v->text = NULL;
+	v->ids = NULL;
+}
+
+void free_view(struct board_view *v)
+{
+	free(v->text);
+	free(v->ids);
+	make_view(v);
+}
+
+/* Brings v->text up to print_cropped(b). While the bounding box stays put
+ * only cells in chunks changed since the last update are looked at, and
+ * only the ones whose tiles changed redrawn. Returns nonzero if out of
+ * memory, leaving v as it was. */
+int update_view(struct board_view *v, const struct board *b)
+{
+	const struct box box = tile_box(b);
+	const size_t cols = box.y1 - box.y0 + 1;
+	if (!v->text || memcmp(&box, &v->box, sizeof(box))) {
+		const size_t n = (box_len(box) - 1) / (TILE_LEN - 1);
+		char *text = malloc(box_len(box));
+		uint16_t *ids = malloc((n ? n : 1) * sizeof(*ids));
+		if (!text || !ids) {
+			free(text);
+			free(ids);
+			return 1;
+		}
+		free(v->text);
+		free(v->ids);
+		v->text = print_box(b, box, text);
+		v->ids = ids;
+		v->box = box;
+		for (unsigned int x = box.x0; x <= box.x1; ++x) {
+			for (unsigned int y = box.y0; y <= box.y1; ++y) {
+				const size_t i = x - box.x0;
+				ids[i * cols + y - box.y0] =
+					board_tile(b, make_slot(x, y));
+			}
+		}
+		v->epoch = b->epoch;
+		return 0;
+	}
+	for (size_t i = 0; i < b->chunk_cap; ++i) {
+		const struct chunk *c = b->chunks[i];
+		if (!c || c->epoch <= v->epoch) {
+			continue;
+		}
+		for (unsigned int l = 0; l < CHUNK_CELLS; ++l) {
+			const struct slot s = local_slot(c, l);
+			if (s.x < box.x0 || s.x > box.x1 ||
+					s.y < box.y0 || s.y > box.y1) {
+				continue;
+			}
+			uint16_t *id = &v->ids[(s.x - box.x0) * cols +
+				s.y - box.y0];
+			if (*id != c->tiles[l]) {
+				*id = c->tiles[l];
+				draw_cell(v->text, box, s, *id);
+			}
+		}
+	}
+	v->epoch = b->epoch;
+	return 0;
+}
+
+/* See TODO for invalid_move. If u isn't NULL it's filled in so that
+ * unplay_move_board() can take the move back. */
+int play_move_board(struct board *b, struct move m, struct board_undo *u)
 {
 	int rc;
-	if ((rc = invalid_move(*b, m))) {
+	/* Check the edges as they'll actually sit on the board. */
+	const unsigned int id = rotate_id(tile_to_id(m.tile), m.rotation);
+	if ((rc = invalid_move(b, m.slot, id)) ||
+			(rc = reserve_move(b, m.slot))) {
 		return rc;
 	}
-	b->tiles[index_slot(m.slot)] = rotate_tile(m.tile, m.rotation);
-	*b = update_slot_spots(*b, m.slot);
+	struct board_undo scratch;
+	if (!u) {
+		u = &scratch;
+	}
+	u->slot = m.slot;
+	u->box = b->box;
+	struct chunk *c = find_chunk(b, m.slot);
+	c->tiles[local_index(m.slot)] = id;
+	c->order[local_index(m.slot)] = b->tile_count;
+	c->epoch = ++b->epoch;
+	c->around[local_index(m.slot)] = count_around(b, m.slot, 1);
+	toggle_hashes(b, m.slot, id);
+	if (!b->tile_count++) {
+		b->box.x0 = b->box.x1 = m.slot.x;
+		b->box.y0 = b->box.y1 = m.slot.y;
+	} else {
+		b->box.x0 = m.slot.x < b->box.x0 ? m.slot.x : b->box.x0;
+		b->box.y0 = m.slot.y < b->box.y0 ? m.slot.y : b->box.y0;
+		b->box.x1 = m.slot.x > b->box.x1 ? m.slot.x : b->box.x1;
+		b->box.y1 = m.slot.y > b->box.y1 ? m.slot.y : b->box.y1;
+	}
+	mark_edges(b, m.slot, id, 1);
+	update_slot_spots(b, m.slot, u);
+	return 0;
+}
+
+/* Undoes the last move played. Moves must be unplayed in reverse order.
+ * Chunks the move made stay around, empty, for the next one. This only
+ * fails (returning 4, with b untouched) when the move came before a
+ * board_fork() and copying the chunks it touched runs out of memory. */
+int unplay_move_board(struct board *b, struct board_undo u)
+{
+	const struct frontier *f = &b->frontier;
+	/* Putting u.slot back moves whatever is in its place now. */
+	const struct slot *moved = u.pos < f->count ? &f->cells[u.pos] : NULL;
+	if (own_chunks(b, u.slot, moved)) {
+		return 4;
+	}
+	restore_slot_spots(b, u);
+	const unsigned int id = board_tile(b, u.slot);
+	mark_edges(b, u.slot, id, 0);
+	toggle_hashes(b, u.slot, id);
+	count_around(b, u.slot, -1);
+	struct chunk *c = find_chunk(b, u.slot);
+	c->tiles[local_index(u.slot)] = 0;
+	c->epoch = ++b->epoch;
+	b->tile_count--;
+	b->box = u.box;
 	return 0;
 }
 
 #ifdef TEST
-static void print_placeable_slots(struct board b)
-<<<<<<< HEAD
+static void print_placeable_slots(const struct board *b)
 {
 	printf("Slots:\n");
 	printf("X\tY\n");
-	for (size_t i = 0; i < b.sps; ++i) {
-		printf("%u\t%u\n", b.slot_spots[i].x, b.slot_spots[i].y);
+	for (size_t i = 0; i < b->frontier.count; ++i) {
+		struct slot s = b->frontier.cells[i];
+		printf("%u\t%u\n", s.x, s.y);
 	}
 	return;
 }
 
-static void play_and_check_move(struct board *b, struct move m)
+/* Whether chunk c looks the same in b. Missing chunks count as empty. */
+static int chunk_matches(const struct chunk *c, const struct board *b)
 {
-=======
+	static const struct chunk none;
+	const struct chunk *d = find_chunk(b, local_slot(c, 0));
+	d = d ? d : &none;
+	if (memcmp(c->tiles, d->tiles, sizeof(c->tiles)) ||
+			memcmp(c->edges, d->edges, sizeof(c->edges)) ||
+			c->open != d->open) {
+		return 0;
+	}
+	for (unsigned int l = 0; l < CHUNK_CELLS; ++l) {
+		if (c->tiles[l] && c->around[l] != d->around[l]) {
+			return 0;
+		}
+	}
+	for (uint64_t o = c->open; o; o &= o - 1) {
+		if (c->pos[__builtin_ctzll(o)] != d->pos[__builtin_ctzll(o)]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int boards_equal(const struct board *a, const struct board *b)
 {
-	printf("Slots:\n");
-	printf("X\tY\n");
-	for (size_t i = 0; i < b.sps; ++i) {
-		printf("%u\t%u\n", b.slot_spots[i].x, b.slot_spots[i].y);
+	const struct frontier *f = &a->frontier, *g = &b->frontier;
+	const size_t n = f->count;
+	for (size_t i = 0; i < a->chunk_cap; ++i) {
+		if (a->chunks[i] && !chunk_matches(a->chunks[i], b)) {
+			return 0;
+		}
 	}
-	return;
+	for (size_t i = 0; i < b->chunk_cap; ++i) {
+		if (b->chunks[i] && !chunk_matches(b->chunks[i], a)) {
+			return 0;
+		}
+	}
+	return a->tile_count == b->tile_count &&
+		!memcmp(a->hashes, b->hashes, sizeof(a->hashes)) &&
+		(!a->tile_count || !memcmp(&a->box, &b->box, sizeof(a->box))) &&
+		f->count == g->count &&
+		!memcmp(f->cells, g->cells, sizeof(f->cells[0]) * n) &&
+		!memcmp(f->sig, g->sig, sizeof(f->sig[0]) * n) &&
+		!memcmp(f->next, g->next, sizeof(f->next[0]) * n) &&
+		!memcmp(f->prev, g->prev, sizeof(f->prev[0]) * n) &&
+		!memcmp(f->heads, g->heads, sizeof(f->heads));
+}
+
+/* Whether the hashes match ones built from scratch. */
+static int hashes_right(const struct board *b)
+{
+	struct board fresh = *b;
+	memset(fresh.hashes, 0, sizeof(fresh.hashes));
+	for (size_t i = 0; i < b->chunk_cap; ++i) {
+		const struct chunk *c = b->chunks[i];
+		for (unsigned int l = 0; c && l < CHUNK_CELLS; ++l) {
+			if (c->tiles[l]) {
+				toggle_hashes(&fresh, local_slot(c, l),
+					c->tiles[l]);
+			}
+		}
+	}
+	return !memcmp(fresh.hashes, b->hashes, sizeof(b->hashes));
+}
+
+/* Every tile's count of tiles around it is right. */
+static void check_around(const struct board *b)
+{
+	for (size_t i = 0; i < b->chunk_cap; ++i) {
+		const struct chunk *c = b->chunks[i];
+		for (unsigned int l = 0; c && l < CHUNK_CELLS; ++l) {
+			const struct slot s = local_slot(c, l);
+			unsigned int n = 0;
+			if (!c->tiles[l]) {
+				continue;
+			}
+			for (int k = 0; k < 8; ++k) {
+				struct slot t = s;
+				t.x += around_dx[k];
+				t.y += around_dy[k];
+				n += !!board_tile(b, t);
+			}
+			assert(board_around(b, s) == n);
+		}
+	}
+}
+
+/* Every open slot is in the chain for the signature its neighbours give.*/
+static void check_chains(const struct board *b)
+{
+	const struct frontier *f = &b->frontier;
+	size_t n = 0;
+	for (unsigned int sig = 0; sig < SIGNATURES; ++sig) {
+		for (unsigned int p = f->heads[sig]; p != NIL; p = f->next[p]) {
+			assert(f->sig[p] == sig);
+			const struct slot s = f->cells[p];
+			assert(cell_signature(find_chunk(b, s),
+				local_index(s)) == sig);
+			n++;
+		}
+	}
+	assert(n == f->count);
+}
+
+/* slot_fills() and dead_slots() agree with trying every tile left in every
+ * rotation, left[k] being how many of kind k there are. */
+static void check_fills(const struct board *b,
+		const unsigned int left[TILE_KINDS])
+{
+	static struct slot dead[FRONTIER_MAX];
+	const struct frontier *f = &b->frontier;
+	const size_t n = dead_slots(b, dead);
+	size_t want = 0;
+	unsigned int deck = 0;
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		deck += left[k];
+	}
+	assert(b->deck == deck);
+	for (size_t p = 0; p < f->count; ++p) {
+		unsigned int fits = 0;
+		for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+			int r = 0;
+			while (r < 4 && invalid_move(b, f->cells[p],
+					rotate_id(KIND_ID(k), r))) {
+				r++;
+			}
+			fits += r < 4 ? left[k] : 0;
+		}
+		assert(slot_fills(b, f->cells[p]) == fits);
+		want += !fits;
+	}
+	assert(n == want);
+	for (size_t i = 0; i < n; ++i) {
+		assert(!slot_fills(b, dead[i]));
+	}
+}
+
+/* Updating v gives what printing b cropped from scratch does. */
+static void check_view(struct board_view *v, const struct board *b)
+{
+	char *want = malloc(cropped_len(b));
+	assert(want && !update_view(v, b));
+	assert(!strcmp(v->text, print_cropped(b, want)));
+	assert(strlen(want) + 1 == cropped_len(b));
+	free(want);
+}
+
+/* Plays a tile of kind k on b at the d'th place it fits, counting round,
+ * so rising d spreads moves about. Returns whether it fit anywhere. */
+static int play_kind(struct board *b, unsigned int k, size_t d,
+		struct board_undo *u)
+{
+	static struct move moves[MOVES_MAX];
+	const size_t n = generate_moves(b, id_to_tile(KIND_ID(k)), moves);
+	if (n) {
+		assert(!play_move_board(b, moves[(d * 31) % n], u));
+	}
+	return n > 0;
 }
 
 static void play_and_check_move(struct board *b, struct move m)
 {
->>>>>>> Nick495/dev
 	int rc;
-	if ((rc = play_move_board(b, m))) {
+	if ((rc = play_move_board(b, m, NULL))) {
 		printf("Invalid move! %d\n", rc);
 	} else {
 		printf("Good move!\n");
@@ -295,46 +1254,26 @@ static void play_and_check_move(struct board *b, struct move m)
 int main(void)
 {
 	char buffer[TILE_LEN];
-<<<<<<< HEAD
-<<<<<<< HEAD
-=======
-	char board_buffer[BOARD_LEN];
->>>>>>> origin/dev
-	enum edge edges[5][5] = {
-		{ EMPTY, EMPTY, EMPTY, EMPTY, EMPTY },
-		{ GAME-TRAIL, GAME-TRAIL, GAME-TRAIL, GAME-TRAIL, GAME-TRAIL },
-		{ JUNGLE, JUNGLE, JUNGLE, JUNGLE, JUNGLE },
-		{ LAKE, LAKE, LAKE, LAKE, LAKE },
-		{ LAKE, JUNGLE, GAME-TRAIL, LAKE, GAME-TRAIL }
-=======
-	char board_buffer[BOARD_LEN];
 	enum edge edges[5][5] = {
 		{ EMPTY, EMPTY, EMPTY, EMPTY, EMPTY },
 		{ ROAD, ROAD, ROAD, ROAD, ROAD },
 		{ FIELD, FIELD, FIELD, FIELD, FIELD },
 		{ CITY, CITY, CITY, CITY, CITY },
 		{ CITY, FIELD, ROAD, CITY, ROAD }
->>>>>>> Nick495/dev
 	};
 	struct tile tiles[5] = {
 		make_tile(edges[0], NONE),
 		make_tile(edges[1], NONE),
-		make_tile(edges[2], NONE),
-		make_tile(edges[3], NONE),
+		make_tile(edges[2], MONASTERY),
+		make_tile(edges[3], SHIELD),
 		make_tile(edges[4], NONE)
 	};
 
 	const char string[5][30] = {
 		"\nEmpty tile:",
-<<<<<<< HEAD
-		"\nAll GAME-TRAIL tile:",
-		"\nAll JUNGLE tile:",
-		"\nAll LAKE tile:",
-=======
 		"\nAll Road tile:",
 		"\nAll Field tile:",
 		"\nAll City tile:",
->>>>>>> Nick495/dev
 		"\nMixed tile:"
 	};
 
@@ -349,82 +1288,413 @@ int main(void)
 			print_tile(rotate_tile(tiles[4], i), buffer));
 	}
 
+	printf("\nPacked tiles round trip.\n");
+	for (int i = 0; i < 5; ++i) {
+		assert(tile_eq(unpack_tile(pack_tile(tiles[i])), tiles[i]));
+	}
+	assert(pack_tile(tiles[0]) == 0);
+
+	printf("\nCatalog ids.\n");
+	assert(tile_to_id(tiles[0]) == 0 && tile_to_id(tiles[4]) == 0);
+	for (unsigned int id = 1; id < TILE_IDS; ++id) {
+		const unsigned int c = tile_to_id(id_to_tile(id));
+		for (int r = 0; r < 4; ++r) {
+			assert(tile_eq(id_to_tile(rotate_id(c, r)),
+				rotate_tile(id_to_tile(id), r)));
+		}
+	}
+	assert(rotate_id(tile_to_id(tiles[1]), 3) == tile_to_id(tiles[1]));
+	/* Every packing looks up the lowest id packed that way, if any. */
+	for (unsigned int p = 0; p < 1 << 12; ++p) {
+		unsigned int want = 0;
+		for (unsigned int id = TILE_IDS - 1; id > 0; --id) {
+			want = id_packed(id) == p ? id : want;
+		}
+		assert(tile_to_id(unpack_tile(p)) == want);
+	}
+	{
+		struct tile t = id_to_tile(1);
+		t.edges[2] = 4;
+		assert(!tile_to_id(t));
+	}
+
+	printf("\nFeatures cover each tile, and turn with it.\n");
+	for (unsigned int id = 1; id < TILE_IDS; ++id) {
+		struct feature f[FEATURES_MAX], g[FEATURES_MAX];
+		const uint16_t p = id_packed(id);
+		const unsigned int n = tile_features(id, f);
+		uint16_t all = 0;
+		for (unsigned int i = 0; i < n; ++i) {
+			assert(!(all & f[i].segments));
+			all |= f[i].segments;
+			for (uint16_t m = f[i].segments & 0xfff; m; m &= m - 1) {
+				const unsigned int s = __builtin_ctz(m);
+				const enum edge e = PACKED_EDGE(p, s / 3);
+				const enum edge want = e == ROAD && s % 3 != 1
+					? FIELD : e;
+				assert((enum edge) f[i].kind == want);
+			}
+			for (unsigned int b = f[i].borders; b; b &= b - 1) {
+				const unsigned int j = __builtin_ctz(b);
+				assert(f[i].kind == FEATURE_FIELD);
+				assert(f[j].kind == FEATURE_CITY);
+			}
+		}
+		assert((all & 0xfff) == 0xfff);
+		assert(tile_features(rotate_id(id, 1), g) == n);
+		for (unsigned int i = 0; i < n; ++i) {
+			unsigned int j = 0;
+			while (g[j].segments !=
+					rotate_segments(f[i].segments, 1)) {
+				assert(++j < n);
+			}
+			assert(g[j].kind == f[i].kind);
+		}
+	}
+	for (unsigned int s = 0; s < CENTRE_SEGMENT; ++s) {
+		assert(SEGMENT_ACROSS(SEGMENT_ACROSS(s)) == s);
+		assert(SEGMENT_ACROSS(s) / 3 == (s / 3 + 2) % 4);
+	}
+	struct feature f[FEATURES_MAX];
+	const enum edge caps[5] = { CITY, CITY, FIELD, FIELD, FIELD };
+	assert(tile_features(tile_to_id(tiles[1]), f) == 8); /* Crossroads. */
+	assert(tile_features(KIND_ID(START_KIND), f) == 4);
+	/* Only the field on the city's side of the road touches it. */
+	assert(f[2].kind == FEATURE_FIELD && f[3].kind == FEATURE_FIELD);
+	assert(!f[2].borders + !f[3].borders == 1);
+	assert(tile_features(tile_to_id(make_tile(caps, NONE)), f) == 3);
+	assert(f[2].kind == FEATURE_FIELD && f[2].borders == 3);
+	assert(tile_features(tile_to_id(tiles[2]), f) == 2); /* Monastery. */
+
+	printf("\nSteps inside a chunk agree with slot arithmetic.\n");
+	static const struct chunk origin;
+	for (unsigned int l = 0; l < CHUNK_CELLS; ++l) {
+		struct slot adj[4];
+		assert(local_index(local_slot(&origin, l)) == l);
+		adjacent_slots(local_slot(&origin, l), adj);
+		for (int i = 0; i < 4; ++i) {
+			const int inside = adj[i].x < CHUNK_SIDE &&
+				adj[i].y < CHUNK_SIDE;
+			const unsigned int n = local_step(l, i);
+			const unsigned int want = local_index(adj[i]);
+			assert(n == (inside ? want : CHUNK_CELLS));
+		}
+	}
+
 	printf("\nTesting board creation. All Null.\n");
-	struct board b = make_board();
-	printf("%s\n", print_board(b, board_buffer));
+	struct board b;
+	assert(!make_board(&b, AXIS));
+	char *board_buffer = malloc(board_len(&b));
+	printf("%s\n", print_board(&b, board_buffer));
 
 	printf("\nLet's see what slots are placeable.\n");
-	print_placeable_slots(b);
+	print_placeable_slots(&b);
 	const unsigned int mid = AXIS / 2;
 	printf("\nPlay the center (%d, %d), the starting move.\n", mid, mid);
 	play_and_check_move(&b, make_move(tiles[3], make_slot(mid, mid), 0));
-	printf("%s\n", print_board(b, board_buffer));
+	printf("%s\n", print_board(&b, board_buffer));
 
 	printf("\nAnd now what slots are placeable?\n");
-	print_placeable_slots(b);
+	print_placeable_slots(&b);
 
 	printf("\nTest tile validator (should fail): (%d, %d)\n", mid, mid + 1);
 	play_and_check_move(&b,make_move(tiles[2], make_slot(mid, mid + 1), 0));
-	printf("%s\n", print_board(b, board_buffer));
-	print_placeable_slots(b);
+	printf("%s\n", print_board(&b, board_buffer));
+	print_placeable_slots(&b);
 
 	printf("\nTest tile validator (should pass): (%d, %d)\n", mid, mid + 1);
 	play_and_check_move(&b,make_move(tiles[3], make_slot(mid, mid + 1), 0));
-	printf("%s\n", print_board(b, board_buffer));
-	print_placeable_slots(b);
+	printf("%s\n", print_board(&b, board_buffer));
+	print_placeable_slots(&b);
+
+	printf("\nTest undo: play (%d, %d) and take it back.\n", mid, mid - 1);
+	struct board before;
+	assert(!board_fork(&before, &b));
+	struct board_undo u;
+	assert(!play_move_board(&b,
+		make_move(tiles[3], make_slot(mid, mid - 1), 0), &u));
+	assert(!boards_equal(&b, &before));
+	check_chains(&b);
+	unplay_move_board(&b, u);
+	assert(boards_equal(&b, &before));
+	print_placeable_slots(&b);
+
+	printf("\nForks share chunks until one of them writes.\n");
+	struct board fork;
+	assert(!board_fork(&fork, &b) && boards_equal(&fork, &b));
+	assert(!play_move_board(&fork,
+		make_move(tiles[3], make_slot(mid, mid - 1), 0), &u));
+	assert(boards_equal(&b, &before) && !boards_equal(&fork, &b));
+	assert(!unplay_move_board(&fork, u));
+	assert(boards_equal(&fork, &b));
+	free_board(&fork);
+
+	printf("\nBulk fits agree with single moves.\n");
+	static struct slot fits[FRONTIER_MAX];
+	for (unsigned int id = 1; id < TILE_IDS; ++id) {
+		static char fit[AXIS][AXIS];
+		const size_t n = fitting_slots(&b, id, fits);
+		memset(fit, 0, sizeof(fit));
+		for (size_t i = 0; i < n; ++i) {
+			fit[fits[i].x][fits[i].y] = 1;
+		}
+		for (unsigned int x = 0; x < AXIS; ++x) {
+			for (unsigned int y = 0; y < AXIS; ++y) {
+				struct move m = make_move(id_to_tile(id),
+					make_slot(x, y), 0);
+				struct board_undo u;
+				if (!play_move_board(&b, m, &u)) {
+					unplay_move_board(&b, u);
+					assert(fit[x][y]);
+				} else {
+					assert(!fit[x][y]);
+				}
+			}
+		}
+	}
+	assert(boards_equal(&b, &before));
+
+	printf("\nGenerated moves all play, and cover every fit.\n");
+	static struct move moves[MOVES_MAX];
+	static struct slot moves_at[FRONTIER_MAX];
+	for (unsigned int id = 1; id < TILE_IDS; ++id) {
+		struct tile t = id_to_tile(id);
+		size_t fits = 0, n = generate_moves(&b, t, moves);
+		for (size_t i = 0; i < n; ++i) {
+			struct board_undo u;
+			assert(!play_move_board(&b, moves[i], &u));
+			unplay_move_board(&b, u);
+		}
+		for (int r = 0; r < 4; ++r) {
+			const unsigned int c = tile_to_id(t);
+			if (r && rotate_id(c, r) == c) {
+				break;
+			}
+			fits += fitting_slots(&b, rotate_id(c, r), moves_at);
+		}
+		assert(n == fits);
+	}
+	printf("All-city tile: %zu moves.\n",
+		generate_moves(&b, tiles[3], moves));
 
+	printf("\nPlay and unplay a few generated moves deep.\n");
+	struct board_undo undos[8];
+	struct board_view view;
+	{
+		struct board e;
+		assert(!make_board(&e, AXIS));
+		make_view(&view);
+		check_view(&view, &e); /* Nothing to draw, but drawn. */
+		assert(view.text && !*view.text);
+		free_view(&view);
+		free_board(&e);
+	}
+	make_view(&view);
+	for (int d = 0; d < 8; ++d) {
+		struct tile t = id_to_tile(KIND_ID((d * 7) % TILE_KINDS));
+		size_t n = generate_moves(&b, t, moves);
+		assert(n > 0);
+		assert(!play_move_board(&b, moves[n / 2], &undos[d]));
+		check_chains(&b);
+		check_around(&b);
+		check_view(&view, &b);
+	}
+	for (int d = 7; d >= 0; --d) {
+		unplay_move_board(&b, undos[d]);
+		check_chains(&b);
+		check_around(&b);
+		check_view(&view, &b);
+	}
+	printf("%s\n", view.text);
+	assert(boards_equal(&b, &before));
+	assert(hashes_right(&b) && b.hashes[0]);
+
+	printf("\nTwo orders to one position hash the same.\n");
+	struct board c, d;
+	const struct slot up = make_slot(mid, mid + 1);
+	const struct slot down = make_slot(mid, mid - 1);
+	assert(!make_board(&c, AXIS) && !make_board(&d, AXIS));
+	assert(!play_move_board(&c, make_move(tiles[3], make_slot(mid, mid), 0),
+		NULL));
+	assert(!play_move_board(&d, make_move(tiles[3], make_slot(mid, mid), 0),
+		NULL));
+	assert(!play_move_board(&c, make_move(tiles[3], up, 0), NULL));
+	assert(!play_move_board(&c, make_move(tiles[3], down, 0), NULL));
+	assert(!play_move_board(&d, make_move(tiles[3], down, 0), NULL));
+	assert(c.hashes[0] != d.hashes[0]);
+	assert(!play_move_board(&d, make_move(tiles[3], up, 0), NULL));
+	assert(c.hashes[0] == d.hashes[0]);
+	free_board(&c);
+	free_board(&d);
+	for (size_t i = 0; i < b.frontier.count; ++i) {
+		assert(slot_fillable(&b, b.frontier.cells[i]));
+	}
+
+	printf("\nA long game on a big board, then all the way back.\n");
+	struct board big, fresh;
+	assert(!make_board(&big, 1001));
+	assert(!board_fork(&fresh, &big));
+	static struct board_undo long_undos[TILE_COUNT];
+	size_t played = 0;
+	for (int d = 0; played < TILE_COUNT; ++d) {
+		if (play_kind(&big, (d * 7) % TILE_KINDS, d,
+				&long_undos[played])) {
+			played++;
+			check_view(&view, &big);
+		}
+	}
+	check_chains(&big);
+	check_around(&big);
+	assert(hashes_right(&big));
+
+	printf("\nEvery symmetry of it has the same canonical hash.\n");
+	for (int k = 0; k < SYMMETRIES; ++k) {
+		struct board t;
+		assert(!make_board(&t, 1001));
+		for (size_t i = 0; i < TILE_COUNT; ++i) {
+			const struct slot s = long_undos[i].slot;
+			const unsigned int id = board_tile(&big, s);
+			struct tile tk = id_to_tile(transform_id(id, k));
+			struct slot sk = transform_slot(&big, s, k);
+			struct move m = make_move(tk, sk, 0);
+			assert(!play_move_board(&t, m, NULL));
+		}
+		assert(t.hashes[0] == big.hashes[k]);
+		assert(canonical_hash(&t) == canonical_hash(&big));
+		free_board(&t);
+	}
+	assert(big.tile_count == TILE_COUNT && big.chunk_count > 1);
+	assert(big.box.x0 <= 500 && big.box.x1 >= 500);
+	printf("%zu chunks, box (%u, %u) to (%u, %u).\n", big.chunk_count,
+		big.box.x0, big.box.y0, big.box.x1, big.box.y1);
+	struct board late;
+	assert(!board_fork(&late, &big));
+	for (size_t i = played; i; --i) {
+		assert(!unplay_move_board(&big, long_undos[i - 1]));
+	}
+	check_chains(&big);
+	assert(boards_equal(&big, &fresh));
+	/* The fork kept the whole game, and can take it back too. */
+	check_chains(&late);
+	check_around(&late);
+	assert(hashes_right(&late) && late.tile_count == TILE_COUNT);
+	while (played) {
+		assert(!unplay_move_board(&late, long_undos[--played]));
+		check_view(&view, &late);
+	}
+	assert(boards_equal(&late, &fresh));
+	free_view(&view);
+	free_board(&late);
+
+	printf("\nFill counts follow a deck as it's dealt.\n");
+	struct board dealt;
+	unsigned int left[TILE_KINDS];
+	static struct slot dead[FRONTIER_MAX];
+	assert(!make_board(&dealt, AXIS));
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		left[k] = kind_count(k);
+		board_add_tiles(&dealt, k, left[k]);
+	}
+	check_fills(&dealt, left);
+	/* A whole deck at once comes to the same. */
+	struct board whole;
+	assert(!make_board(&whole, AXIS));
+	board_add_deck(&whole);
+	assert(whole.deck == dealt.deck);
+	assert(!memcmp(whole.fills, dealt.fills, sizeof(whole.fills)));
+	free_board(&whole);
+	for (int d = 0; dealt.deck; ++d) {
+		const unsigned int k = d ? (d * 7) % TILE_KINDS : START_KIND;
+		if (!left[k]) {
+			continue;
+		}
+		left[k]--;
+		board_add_tiles(&dealt, k, -1);
+		play_kind(&dealt, k, d, NULL);
+		check_fills(&dealt, left);
+		if (dealt.deck == TILE_COUNT / 2) {
+			printf("Half way, %zu tiles down, %zu of %zu slots "
+				"dead.\n", dealt.tile_count,
+				dead_slots(&dealt, dead), dealt.frontier.count);
+		}
+	}
+	free_board(&dealt);
+
+	free_board(&big);
+	free_board(&fresh);
+	free_board(&before);
+	free_board(&b);
+	free(board_buffer);
 	return 0;
 }
 #endif
-<<<<<<< HEAD
 
-struct board make_board(void)
+#ifdef BENCH
+#ifdef MORTON
+#define LAYOUT "Morton"
+#else
+#define LAYOUT "Row-major"
+#endif
+
+static uint64_t xorshift(void)
 {
-       struct board b;
-       enum edge edges[5] = { EMPTY, EMPTY, EMPTY, EMPTY, EMPTY };
-       const unsigned int mid = (AXIS - 1) / 2; /* Must start in center. */
-       b.slot_spots[0] = make_slot(mid, mid);
-       b.sps = 1;
-       for (unsigned int i = 0; i < AXIS*AXIS; ++i) {
-		b.tiles[i] = make_tile(edges, NONE);
-       }
-       /* Tab between columns except for the last one, which newlines. */
-       memset(b.column_terminators, '\t', AXIS - 1);
-       b.column_terminators[AXIS - 1] = '\n';
-       return b;
+	static uint64_t x = 88172645463325252ull;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
 }
 
-char *print_board(struct board b, char res[BOARD_LEN])
+/* Random full-deck playouts, each taken back move by move afterwards.
+ * Build with and without -DMORTON to compare layouts (make bench). */
+int main(int argc, char **argv)
 {
-	const size_t cnt = TILE_LINES;
-	const size_t len = TILE_LINE_LEN;
-	char buf[TILE_LEN];
+	const int games = argc > 1 ? atoi(argv[1]) : 2000;
+	static struct move moves[MOVES_MAX];
+	static struct board_undo undos[TILE_COUNT];
+	unsigned int deck[TILE_COUNT];
+	size_t n = 0, placed = 0;
+	struct board b;
+	struct timespec t0, t1;
 
-	/* Pretty print the board in NxN format. */
-	for (size_t i = 0; i < AXIS; ++i) {
-		for (size_t j = 0; j < AXIS; ++j) {
-			print_tile(b.tiles[index_slot(make_slot(i, j))], buf);
-			for (size_t k = 0; k < cnt; ++k) {
-				const size_t ind = ((i *cnt +k) *AXIS +j) *len;
-				buf[(k + 1) *len - 1] = b.column_terminators[j];
-				memcpy(&res[ind], &buf[len * k], len);
-			}
+	deck[n++] = KIND_ID(START_KIND);
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		for (unsigned int i = k == START_KIND; i < kind_count(k); ++i) {
+			deck[n++] = KIND_ID(k);
 		}
 	}
-	res[BOARD_LEN - 1] = '\0';
-	return res;
-}
-
-/* See TODO for invalid_move. */
-int play_move_board(struct board *b, struct move m)
-{
-	int rc;
-	if ((rc = invalid_move(*b, m))) {
-		return rc;
+	assert(n == TILE_COUNT);
+	if (make_board(&b, AXIS)) {
+		return 1;
 	}
-	b->tiles[index_slot(m.slot)] = rotate_tile(m.tile, m.rotation);
-	*b = update_slot_spots(*b, m.slot);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (int g = 0; g < games; ++g) {
+		size_t played = 0;
+		for (size_t i = TILE_COUNT - 1; i > 1; --i) {
+			const size_t j = 1 + xorshift() % i;
+			const unsigned int swap = deck[i];
+			deck[i] = deck[j];
+			deck[j] = swap;
+		}
+		for (size_t i = 0; i < TILE_COUNT; ++i) {
+			struct tile t = id_to_tile(deck[i]);
+			const size_t m = generate_moves(&b, t, moves);
+			if (m && !play_move_board(&b, moves[xorshift() % m],
+					&undos[played])) {
+				played++;
+			}
+		}
+		placed += played;
+		while (played) {
+			unplay_move_board(&b, undos[--played]);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	const double ns = (t1.tv_sec - t0.tv_sec) * 1e9
+		+ (t1.tv_nsec - t0.tv_nsec);
+	printf("%s: %d games, %zu tiles, %.1f ns per tile in and out.\n",
+		LAYOUT, games, placed, ns / placed);
+	free_board(&b);
 	return 0;
 }
-=======
->>>>>>> Nick495/dev
+#endif
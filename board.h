@@ -4,22 +4,120 @@
 #include <stdio.h>
 #include <string.h>	/* memcpy */
 #include <stdlib.h>	/* free() */
+#include <stdint.h>	/* uint16_t */
 #include "edge.h"	/* edges. */
 #include "tile.h"	/* tiles. */
 #include "slot.h"	/* slots. */
 #include "move.h"	/* moves. */
 #include "limits.h"	/* sizes of things. */
 
-#define BOARD_LEN AXIS * AXIS * (TILE_LEN - 1) + 1
+#define CHUNK_SHIFT 3
+#define CHUNK_SIDE (1 << CHUNK_SHIFT)
+#define CHUNK_CELLS (CHUNK_SIDE * CHUNK_SIDE) /* A bit each in a uint64_t */
+#define MOVES_MAX (4 * FRONTIER_MAX) /* Every rotation in every open slot. */
+
+#define NIL 0xffff /* End of a signature chain. */
+
+/* A CHUNK_SIDE by CHUNK_SIDE square of cells. Chunks only exist where
+ * tiles or open slots are, so a board costs memory by tiles placed. */
+struct chunk {
+	unsigned int cx; /* Chunk coordinates: the slot's / CHUNK_SIDE. */
+	unsigned int cy;
+	unsigned int refs; /* Boards sharing it, see board_fork(). */
+	uint16_t tiles[CHUNK_CELLS]; /* Tile ids, 0 is empty. */
+	uint16_t order[CHUNK_CELLS]; /* Tiles placed before each one. */
+	uint8_t around[CHUNK_CELLS]; /* Tiles in the 8 cells round each one. */
+	/* edges[i][e - 1] has a cell's bit set when the neighbour on its side
+	 * i (up, right, down, left) shows it edge e. */
+	uint64_t edges[4][3];
+	uint64_t open; /* Cells in the frontier. */
+	uint16_t pos[CHUNK_CELLS]; /* Where open cells sit in the frontier. */
+	uint32_t epoch; /* The board's, when a tile here last changed. */
+};
+
+/* Open slot spots (placeable slots), listed densely in cells. Members are
+ * also chained by their neighbour signature (see signature_fits()),
+ * through next and prev, which index cells. The arrays hold cap. */
+struct frontier {
+	struct slot *cells;
+	uint8_t *sig;
+	uint16_t *next;
+	uint16_t *prev;
+	size_t count;
+	size_t cap;
+	uint16_t heads[SIGNATURES];
+};
+
+struct box {
+	unsigned int x0, y0; /* Inclusive. */
+	unsigned int x1, y1;
+};
 
 struct board {
-	struct tile tiles[AXIS*AXIS];
-	struct slot slot_spots[AXIS*AXIS];
-	unsigned int sps; /* # of open slot spots (placeable slots) */
-	char column_terminators[AXIS];
+	unsigned int axis; /* Slots run from 0 to axis - 1 both ways. */
+	struct chunk **chunks; /* Open addressing on chunk coordinates. */
+	size_t chunk_cap; /* A power of 2. */
+	size_t chunk_count;
+	size_t tile_count;
+	uint32_t epoch; /* Counts moves played and unplayed. */
+	struct box box; /* Around every tile, when there are any. */
+	/* Zobrist hashes of the tiles under each symmetry about the start
+	 * slot (see transform_id()). hashes[0] is the board as it lies. */
+	uint64_t hashes[SYMMETRIES];
+	struct frontier frontier;
+	/* Tiles left to come that some rotation of would fit a slot with
+	 * each signature, and how many are left in all. Counts only change
+	 * as tiles are dealt (see board_add_tiles()); slots pick theirs up
+	 * by signature as tiles land around them. */
+	uint16_t fills[SIGNATURES];
+	unsigned int deck;
+};
+
+/* Text of a board's tiles, cropped to them, kept up to date a frame at a
+ * time (see update_view()). */
+struct board_view {
+	struct box box; /* What text covers. */
+	uint32_t epoch; /* The board's, when last brought up to date. */
+	char *text;
+	uint16_t *ids; /* The tile drawn at each slot in box, row by row. */
+};
+
+/* Everything play_move_board() needs to take a move back. */
+struct board_undo {
+	struct slot slot;
+	uint16_t pos; /* Where slot sat in the frontier. */
+	uint16_t prev[5]; /* Chain predecessors of slot, then its neighbours. */
+	uint8_t sig; /* slot's signature. */
+	unsigned char added; /* Neighbours (up, right, down, left) opened. */
+	struct box box; /* The bounding box before. */
 };
 
-struct board make_board(void);
-char *print_board(struct board b, char res[BOARD_LEN]);
-int play_move_board(struct board *b, struct move m);
+uint64_t hash_mix(uint64_t x);
+int make_board(struct board *b, unsigned int axis);
+int board_fork(struct board *dst, const struct board *src);
+void free_board(struct board *b);
+unsigned int board_tile(const struct board *b, struct slot s);
+size_t board_order(const struct board *b, struct slot s);
+unsigned int board_around(const struct board *b, struct slot s);
+void board_placed(const struct board *b, struct slot *out);
+size_t board_len(const struct board *b);
+char *print_board(const struct board *b, char *res);
+size_t cropped_len(const struct board *b);
+char *print_cropped(const struct board *b, char *res);
+void make_view(struct board_view *v);
+void free_view(struct board_view *v);
+int update_view(struct board_view *v, const struct board *b);
+int play_move_board(struct board *b, struct move m, struct board_undo *u);
+int unplay_move_board(struct board *b, struct board_undo u);
+size_t generate_moves(const struct board *b, struct tile t, struct move *out);
+int slot_fillable(const struct board *b, struct slot s);
+void board_add_tiles(struct board *b, unsigned int kind, int n);
+void board_add_deck(struct board *b);
+unsigned int slot_fills(const struct board *b, struct slot s);
+double fill_probability(const struct board *b, struct slot s);
+size_t dead_slots(const struct board *b, struct slot *out);
+size_t fitting_slots(const struct board *b, unsigned int id, struct slot *out);
+struct slot transform_slot(const struct board *b, struct slot s, int k);
+int canonical_symmetry(const struct board *b);
+uint64_t canonical_hash(const struct board *b);
 #endif
@@ -3,15 +3,9 @@
 
 enum edge {
 	EMPTY = 0,
-<<<<<<< HEAD
-	LAKE = 1,
-	JUNGLE = 2,
-	GAME-TRAIL = 3
-=======
 	CITY = 1,
 	FIELD = 2,
 	ROAD = 3 
->>>>>>> Nick495/dev
 };
 
 #endif
@@ -1,246 +1,495 @@
 #include "game.h"
+#ifdef BENCH
+#include "rngs/mt19937-64.h"
+#endif
 
-static size_t rand_bound(size_t low, size_t high)
+/* Uniform on [0, range), range > 0, by Lemire's multiply and shift: the
+ * high half of a draw times range, throwing out the 2^32 % range low
+ * halves that would favour some results and drawing again. That division
+ * is only done when the low half is small enough to be one of them, which
+ * is rarely. */
+static uint32_t rand_bound(struct pcg32 *rng, uint32_t range)
 {
-	size_t r;
-	do {
-		r = round(genrand64_real1());
-	} while (r < low || r > high);
-	return r;
+	uint64_t m = (uint64_t)pcg32_next(rng) * range;
+	if ((uint32_t)m < range) {
+		const uint32_t t = -range % range;
+		while ((uint32_t)m < t) {
+			m = (uint64_t)pcg32_next(rng) * range;
+		}
+	}
+	return (uint32_t)(m >> 32);
 }
 
 /* Modern Fisher-Yates per Wikipedia.
  * /wiki/Fisher%E2%80%93Yates_shuffle#The_modern_algorithm
 */
-static void shuffle_tiles(struct tile *a, size_t top)
+static void shuffle_kinds(struct pcg32 *rng, uint8_t *a, size_t top)
 {
-	struct timespec tp;
-	clock_gettime(CLOCK_REALTIME, &tp);
-	init_genrand64(tp.tv_nsec); /* Seed the PRNG for the shuffling. */
-
-	for (size_t i = top - 1; i > 1; --i) {
-		size_t j = rand_bound(0, i);
-		struct tile swap = a[i];
+	for (size_t i = top - 1; i + 1 > 1; --i) {
+		const size_t j = rand_bound(rng, i + 1);
+		const uint8_t swap = a[i];
 		a[i] = a[j];
 		a[j] = swap;
 	}
 }
 
-static void init_deck(struct tile deck[TILE_COUNT])
-{
-	/* Tileset: http://russcon.org/RussCon/carcassonne/tiles.html */
-	/* TODO: Refactor so that this fits in 80 columns. */
-	size_t ind = 0;
-	deck[ind++] = /* start tile, must be first. */
-<<<<<<< HEAD
-		make_tile((enum edge[5]){LAKE, GAME-TRAIL, JUNGLE, GAME-TRAIL, GAME-TRAIL},
-		NONE);
-	deck[ind++] =
-		make_tile((enum edge[5]){LAKE, LAKE, LAKE, LAKE, LAKE}, SHIELD);
-	deck[ind++] =
-		make_tile((enum edge[5]){GAME-TRAIL, GAME-TRAIL, GAME-TRAIL, GAME-TRAIL, GAME-TRAIL}, NONE);
-	for (int i = 0; i < 7; ++i) {
-		const enum attribute a[7] =
-			{NONE, NONE, NONE, SHIELD, NONE, SHIELD, SHIELD};
-		const enum edge b[7] = {JUNGLE,JUNGLE,JUNGLE,JUNGLE,GAME-TRAIL,GAME-TRAIL,GAME-TRAIL};
-		deck[ind++] =
-			make_tile((enum edge[5]){LAKE, LAKE, b[i], LAKE, LAKE},
-=======
-		make_tile((enum edge[5]){CITY, ROAD, FIELD, ROAD, ROAD},
-		NONE);
-	deck[ind++] =
-		make_tile((enum edge[5]){CITY, CITY, CITY, CITY, CITY}, SHIELD);
-	deck[ind++] =
-		make_tile((enum edge[5]){ROAD, ROAD, ROAD, ROAD, ROAD}, NONE);
-	for (int i = 0; i < 7; ++i) {
-		const enum attribute a[7] =
-			{NONE, NONE, NONE, SHIELD, NONE, SHIELD, SHIELD};
-		const enum edge b[7] = {FIELD,FIELD,FIELD,FIELD,ROAD,ROAD,ROAD};
-		deck[ind++] =
-			make_tile((enum edge[5]){CITY, CITY, b[i], CITY, CITY},
->>>>>>> Nick495/dev
-			a[i]);
-	}
-	for (int i = 0; i < 4; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){JUNGLE, GAME-TRAIL, GAME-TRAIL, GAME-TRAIL, GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){FIELD, ROAD, ROAD, ROAD, ROAD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 3; ++i) {
-		const enum attribute a[3] = {NONE, SHIELD, SHIELD};
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){JUNGLE, LAKE, JUNGLE, LAKE,LAKE},
-=======
-			make_tile((enum edge[5]){FIELD, CITY, FIELD, CITY,CITY},
->>>>>>> Nick495/dev
-			a[i]);
-	}
-	for (int i = 0; i < 8; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){GAME-TRAIL, JUNGLE, GAME-TRAIL, JUNGLE,GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){ROAD, FIELD, ROAD, FIELD,ROAD},
->>>>>>> Nick495/dev
-			NONE);
+/* Returns nonzero if out of memory. free_game() when done. */
+int make_game(struct game *g)
+{
+	struct timespec tp;
+	clock_gettime(CLOCK_REALTIME, &tp);
+	return make_game_seeded(g, (uint64_t)tp.tv_sec << 30 ^ tp.tv_nsec);
+}
+
+/* Sets up the rest of g around its deck_kinds and seed. A deck that's
+ * whole_deck, some order of deck_template(), gets its counts copied in
+ * from tables rather than counted. */
+static int start_game(struct game *g, int whole_deck)
+{
+	g->tiles_used = g->scores[0] = g->scores[1] = 0;
+	pcg32_seed(&g->rng, g->seed, GAME_STREAM);
+	if (make_graph(&g->graph, TILE_COUNT)) {
+		return 1;
 	}
-	for (int i = 0; i < 10; ++i) {
-		const enum attribute a[5] = {NONE, NONE, NONE, SHIELD, SHIELD};
-<<<<<<< HEAD
-		const enum edge b[2] = {GAME-TRAIL, JUNGLE};
-		deck[ind++] =
-			make_tile((enum edge[5]){LAKE,b[i%2],b[i%2],LAKE,LAKE},
-=======
-		const enum edge b[2] = {ROAD, FIELD};
-		deck[ind++] =
-			make_tile((enum edge[5]){CITY,b[i%2],b[i%2],CITY,CITY},
->>>>>>> Nick495/dev
-			a[i]);
-	}
-	for (int i = 0; i < 9; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){JUNGLE, JUNGLE, GAME-TRAIL, GAME-TRAIL,GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){FIELD, FIELD, ROAD, ROAD,ROAD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 2; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){LAKE,LAKE,JUNGLE,JUNGLE,JUNGLE},
-=======
-			make_tile((enum edge[5]){CITY,CITY,FIELD,FIELD,FIELD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 3; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){JUNGLE,LAKE,JUNGLE,LAKE,JUNGLE},
-=======
-			make_tile((enum edge[5]){FIELD,CITY,FIELD,CITY,FIELD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 2; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){JUNGLE,JUNGLE,GAME-TRAIL,JUNGLE,JUNGLE},
-			DEN);
-	}
-	for (int i = 0; i < 4; ++i) {
-		deck[ind++] =
-			make_tile((enum edge[5]){JUNGLE,JUNGLE,JUNGLE,JUNGLE,JUNGLE},
-			DEN);
-	}
-	for (int i = 0; i < 5; ++i) {
-		deck[ind++] =
-			make_tile((enum edge[5]){LAKE,JUNGLE,JUNGLE,JUNGLE,JUNGLE},
-=======
-			make_tile((enum edge[5]){FIELD,FIELD,ROAD,FIELD,FIELD},
-			MONASTERY);
-	}
-	for (int i = 0; i < 4; ++i) {
-		deck[ind++] =
-			make_tile((enum edge[5]){FIELD,FIELD,FIELD,FIELD,FIELD},
-			MONASTERY);
-	}
-	for (int i = 0; i < 5; ++i) {
-		deck[ind++] =
-			make_tile((enum edge[5]){CITY,FIELD,FIELD,FIELD,FIELD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 3; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){LAKE,GAME-TRAIL,GAME-TRAIL,JUNGLE,GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){CITY,ROAD,ROAD,FIELD,ROAD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 3; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){LAKE,JUNGLE,GAME-TRAIL,GAME-TRAIL,GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){CITY,FIELD,ROAD,ROAD,ROAD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 3; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){LAKE,GAME-TRAIL,GAME-TRAIL,GAME-TRAIL,GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){CITY,ROAD,ROAD,ROAD,ROAD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	for (int i = 0; i < 3; ++i) {
-		deck[ind++] =
-<<<<<<< HEAD
-			make_tile((enum edge[5]){LAKE,GAME-TRAIL,JUNGLE,GAME-TRAIL,GAME-TRAIL},
-=======
-			make_tile((enum edge[5]){CITY,ROAD,FIELD,ROAD,ROAD},
->>>>>>> Nick495/dev
-			NONE);
-	}
-	assert(ind == TILE_COUNT);
-	return;
-}
-
-void make_game(struct game *g)
-{
-	g->graphs_used = g->tiles_used = g->scores[0] = g->scores[1] = 0;
-	init_deck(g->tile_deck);
+	if (make_board(&g->board, AXIS)) {
+		free_graph(&g->graph);
+		return 1;
+	}
+	if (whole_deck) {
+		memcpy(g->kinds_left, kind_counts(), sizeof(g->kinds_left));
+		board_add_deck(&g->board);
+		return 0;
+	}
+	memset(g->kinds_left, 0, sizeof(g->kinds_left));
+	for (int i = 0; i < TILE_COUNT; ++i) {
+		g->kinds_left[g->deck_kinds[i]]++;
+	}
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		if (g->kinds_left[k]) {
+			board_add_tiles(&g->board, k, g->kinds_left[k]);
+		}
+	}
+	return 0;
+}
+
+/* The kinds of the deck make_game_seeded() deals for seed, to make the
+ * game with later through make_game_shuffled(): a copy of deck_template()
+ * shuffled a kind to a byte by a generator of its own, so any number of
+ * threads can shuffle at once. PCG, as seeding it is two steps. */
+void seeded_deck(uint64_t seed, uint8_t kinds[TILE_COUNT])
+{
+	struct pcg32 rng;
+	pcg32_seed(&rng, seed, DECK_STREAM);
+	memcpy(kinds, deck_template(), TILE_COUNT);
 	/* The first index must be 0 (have to start with start tile). */
-	shuffle_tiles(&g->tile_deck[1], TILE_COUNT - 1);
-	g->board = make_board();
-	return;
+	shuffle_kinds(&rng, &kinds[1], TILE_COUNT - 1);
+}
+
+/* make_game(), with the deck shuffled from seed: the same seed deals the
+ * same deck, whatever other threads do. */
+int make_game_seeded(struct game *g, uint64_t seed)
+{
+	seeded_deck(seed, g->deck_kinds);
+	return make_game_shuffled(g, seed, g->deck_kinds);
+}
+
+/* make_game_seeded(g, seed) for kinds from seeded_deck(seed, kinds), with
+ * the shuffle done already. */
+int make_game_shuffled(struct game *g, uint64_t seed,
+		const uint8_t kinds[TILE_COUNT])
+{
+	g->seed = seed;
+	memmove(g->deck_kinds, kinds, sizeof(g->deck_kinds));
+	return start_game(g, 1);
 }
 
-void make_game_with_deck(struct game *g, struct tile *deck)
+/* make_game() with deck dealt in its order, each tile turned the way the
+ * catalog has it. Returns 1 if out of memory, 2 if a tile in deck isn't
+ * in the catalog. */
+int make_game_with_deck(struct game *g, struct tile *deck)
 {
-	memcpy(g->tile_deck, deck, sizeof(*deck) * TILE_COUNT);
+	uint8_t kinds[TILE_COUNT];
+	for (int i = 0; i < TILE_COUNT; ++i) {
+		const unsigned int id = tile_to_id(deck[i]);
+		if (!id) {
+			return 2;
+		}
+		kinds[i] = ID_KIND(id);
+	}
+	g->seed = 0;
+	memcpy(g->deck_kinds, kinds, sizeof(kinds));
+	return start_game(g, 0);
+}
+
+/* Uniform on [0, range), range > 0, from g's generator: the same game
+ * draws the same numbers, whatever other threads do. */
+uint32_t game_rand(struct game *g, uint32_t range)
+{
+	return rand_bound(&g->rng, range);
+}
+
+void free_game(struct game *g)
+{
+	free_graph(&g->graph);
+	free_board(&g->board);
 }
 
-int play_move(struct game *g, struct move m, int player)
+/* What the feature rooted at r is worth as it stands, and to whom. Fields
+ * are only worth anything at the end of the game, 3 a closed city, and
+ * need seen for graph_field_cities(). */
+static struct completion score_feature(const struct graph *gr,
+		unsigned int r, uint8_t *seen)
 {
-	return play_move_board(&g->board, m);
-	// Graph and score stuff here.
+	const struct node *n = &gr->nodes[r];
+	struct completion c = { 0, 0, n->kind };
+	unsigned int most = 0;
+	switch (n->kind) {
+	case FEATURE_CITY:
+		c.points = (n->open ? 1 : 2) * (n->tiles + n->shields);
+		break;
+	case FEATURE_ROAD:
+		c.points = n->tiles;
+		break;
+	case FEATURE_MONASTERY:
+		c.points = 9 - n->open;
+		break;
+	case FEATURE_FIELD:
+		c.points = 3 * graph_field_cities(gr, r, seen);
+		break;
+	default:
+		return c;
+	}
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		most = n->owned[i] > most ? n->owned[i] : most;
+	}
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		c.players |= (n->owned[i] == most) << i;
+	}
+	return c;
+}
+
+static void award(int scores[PLAYER_COUNT], struct completion c, int sign)
+{
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		if (c.players >> i & 1) {
+			scores[i] += sign * c.points;
+		}
+	}
+}
+
+/* If u isn't NULL it's filled in so that unplay_move() can undo m, and
+ * with the features m closed. */
+int play_move(struct game *g, struct move m, int player, struct game_undo *u)
+{
+	struct game_undo scratch;
+	uint16_t done[CLOSED_MAX];
+	size_t closed;
+	int rc;
+	u = u ? u : &scratch;
+	if ((rc = play_move_board(&g->board, m, &u->board))) {
+		return rc;
+	}
+	if (graph_place(&g->graph, &g->board, m.slot, player, &u->graph,
+			done, &closed)) {
+		unplay_move_board(&g->board, u->board);
+		return 4;
+	}
+	u->event_count = closed;
+	for (size_t i = 0; i < closed; ++i) {
+		/* Never a field. */
+		u->events[i] = score_feature(&g->graph, done[i], NULL);
+		award(g->scores, u->events[i], 1);
+	}
+	return 0;
+}
+
+/* Deals the next tile and plays it for player somewhere it fits, picked
+ * by game_rand(): a step of a random playout. The first tile goes in the
+ * middle. moves is scratch for MOVES_MAX moves. Returns 1 if the tile fits
+ * nowhere, so is dealt but not played, 4 if out of memory. */
+int play_random_move(struct game *g, int player, struct move *moves,
+		struct game_undo *u)
+{
+	const unsigned int mid = (AXIS - 1) / 2;
+	const struct tile t = deal_tile(g);
+	if (!g->board.tile_count) {
+		return play_move(g, make_move(t, make_slot(mid, mid), 0),
+			player, u);
+	}
+	const size_t n = generate_moves(&g->board, t, moves);
+	return n ? play_move(g, moves[game_rand(g, n)], player, u) : 1;
+}
+
+/* Moves must be unplayed in reverse order. See unplay_move_board(). */
+int unplay_move(struct game *g, struct game_undo u)
+{
+	const int rc = unplay_move_board(&g->board, u.board);
+	if (rc) {
+		return rc;
+	}
+	graph_unplace(&g->graph, u.graph);
+	for (size_t i = 0; i < u.event_count; ++i) {
+		award(g->scores, u.events[i], -1);
+	}
+	return 0;
+}
+
+/* The scores if the game ended now, with what's still open counted at its
+ * partial value, and the fields. Only looks at those features. Writes
+ * nothing to g, so threads can score the same game at once. */
+void final_scores(const struct game *g, int scores[PLAYER_COUNT])
+{
+	const struct graph *gr = &g->graph;
+	uint8_t seen[TILE_COUNT * FEATURES_MAX] = { 0 };
+	assert(gr->node_count <= sizeof(seen));
+	memcpy(scores, g->scores, sizeof(g->scores));
+	for (unsigned int v = gr->open_head; v != NIL; v = gr->nodes[v].down) {
+		award(scores, score_feature(gr, v, seen), 1);
+	}
+}
+
+/* The board's hash with how far into the deck we are and the scores
+ * folded in, so positions only match when the rest of the game would. */
+uint64_t game_hash(const struct game *g)
+{
+	uint64_t h = g->board.hashes[0] ^ hash_mix(g->tiles_used);
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		h ^= hash_mix(hash_mix(i + 1) ^ (uint64_t) g->scores[i]);
+	}
+	return h;
 }
 
-<<<<<<< HEAD
-=======
 int more_tiles(struct game *g)
 {
 	return TILE_COUNT - g->tiles_used - 1;
 }
 
->>>>>>> Nick495/dev
+/* Tiles are only out of the counts, the board's fill counts too, once
+ * dealt. */
 struct tile deal_tile(struct game *g)
 {
-	return g->tile_deck[g->tiles_used++];
+	const unsigned int k = g->deck_kinds[g->tiles_used];
+	g->kinds_left[k]--;
+	board_add_tiles(&g->board, k, -1);
+	g->tiles_used++;
+	return id_to_tile(KIND_ID(k));
+}
+
+/* Puts the last tile dealt back, for searches going back up the tree. */
+void undeal_tile(struct game *g)
+{
+	const unsigned int k = g->deck_kinds[--g->tiles_used];
+	g->kinds_left[k]++;
+	board_add_tiles(&g->board, k, 1);
+}
+
+/* How many tiles of kind are still to be dealt. */
+unsigned int tiles_left(const struct game *g, unsigned int kind)
+{
+	return g->kinds_left[kind];
 }
 
 #ifdef TEST
 int main(void)
 {
+	const unsigned int mid = (AXIS - 1) / 2;
 	struct game g;
-	make_game(&g);
+
+	/* Bounded draws stay in bounds and reach every value. */
+	{
+		struct pcg32 rng;
+		unsigned int seen[TILE_COUNT] = { 0 };
+		pcg32_seed(&rng, 1, DECK_STREAM);
+		for (int n = 0; n < 100 * TILE_COUNT; ++n) {
+			const uint32_t r = rand_bound(&rng, TILE_COUNT);
+			assert(r < TILE_COUNT);
+			seen[r]++;
+		}
+		for (int i = 0; i < TILE_COUNT; ++i) {
+			assert(seen[i]);
+		}
+		assert(rand_bound(&rng, 1) == 0);
+	}
+
+	assert(!make_game(&g));
 	char buf[TILE_LEN];
+	const uint64_t h = game_hash(&g);
+	static struct game_undo u[TILE_COUNT];
+	assert(!play_move(&g, make_move(id_to_tile(KIND_ID(g.deck_kinds[0])),
+		make_slot(mid, mid), 0), 0, &u[0]));
+	assert(game_hash(&g) != h);
+
+	/* A city of two tiles, one each, is a tie worth 4. */
+	const enum edge cap[5] = { FIELD, FIELD, CITY, FIELD, FIELD };
+	assert(!play_move(&g, make_move(make_tile(cap, NONE),
+		make_slot(mid, mid + 1), 0), 1, &u[1]));
+	assert(u[1].event_count == 1 && u[1].events[0].kind == FEATURE_CITY);
+	assert(u[1].events[0].players == 3 && u[1].events[0].points == 4);
+	assert(g.scores[0] == 4 && g.scores[1] == 4);
+	assert(!unplay_move(&g, u[1]));
+	assert(!g.scores[0] && !g.scores[1]);
+	assert(!unplay_move(&g, u[0]));
+	assert(game_hash(&g) == h);
+
+	/* Dealing and undealing keep the counts of what's left. */
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		assert(tiles_left(&g, k) == kind_count(k));
+	}
+	for (int i = 0; i < TILE_COUNT / 2; ++i) {
+		deal_tile(&g);
+	}
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		unsigned int n = 0;
+		for (size_t i = g.tiles_used; i < TILE_COUNT; ++i) {
+			n += g.deck_kinds[i] == k;
+		}
+		assert(tiles_left(&g, k) == n);
+	}
+	while (g.tiles_used) {
+		undeal_tile(&g);
+	}
+	assert(g.board.deck == TILE_COUNT && game_hash(&g) == h);
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		assert(tiles_left(&g, k) == kind_count(k));
+	}
+
+	/* Decks with a tile not in the catalog are turned away. */
+	{
+		static struct game bad;
+		struct tile deck[TILE_COUNT];
+		const enum edge odd[5] = { ROAD, CITY, ROAD, CITY, FIELD };
+		for (int i = 0; i < TILE_COUNT; ++i) {
+			deck[i] = id_to_tile(KIND_ID(g.deck_kinds[i]));
+		}
+		deck[TILE_COUNT - 1] = make_tile(odd, NONE);
+		assert(!tile_to_id(deck[TILE_COUNT - 1]));
+		assert(make_game_with_deck(&bad, deck) == 2);
+		/* A turned tile is dealt as its kind. */
+		deck[TILE_COUNT - 1] = rotate_tile(id_to_tile(KIND_ID(
+			g.deck_kinds[TILE_COUNT - 1])), 1);
+		assert(!make_game_with_deck(&bad, deck));
+		assert(game_hash(&bad) == game_hash(&g));
+		assert(!memcmp(bad.deck_kinds, g.deck_kinds, TILE_COUNT));
+		/* Its generator is seeded all the same. */
+		struct pcg32 rng;
+		pcg32_seed(&rng, 0, GAME_STREAM);
+		assert(bad.seed == 0 && game_rand(&bad, 1u << 31) ==
+			rand_bound(&rng, 1u << 31));
+		free_game(&bad);
+	}
+
+	/* Seeds decide decks. */
+	{
+		static struct game a, b;
+		assert(!make_game_seeded(&a, 42) && !make_game_seeded(&b, 42));
+		assert(!memcmp(a.deck_kinds, b.deck_kinds, TILE_COUNT));
+		assert(a.seed == 42 && game_hash(&a) == game_hash(&b));
+		free_game(&b);
+		assert(!make_game_seeded(&b, 43));
+		assert(memcmp(a.deck_kinds, b.deck_kinds, TILE_COUNT));
+		free_game(&b);
+		/* Shuffled ahead of time, it's the same game. */
+		uint8_t kinds[TILE_COUNT];
+		seeded_deck(42, kinds);
+		assert(!make_game_shuffled(&b, 42, kinds));
+		assert(!memcmp(a.deck_kinds, b.deck_kinds, TILE_COUNT));
+		assert(b.seed == 42 && tiles_left(&b, START_KIND) ==
+			kind_count(START_KIND));
+		/* And draws the same after the deal. */
+		for (int i = 0; i < 100; ++i) {
+			const uint32_t r = game_rand(&a, TILE_COUNT);
+			assert(r < TILE_COUNT);
+			assert(r == game_rand(&b, TILE_COUNT));
+		}
+		free_game(&a);
+		free_game(&b);
+	}
+
+	/* Then the whole deck, turn about, and back. */
+	static struct move moves[MOVES_MAX];
+	int final[PLAYER_COUNT], last[PLAYER_COUNT] = { 0 };
+	size_t played = 0;
+	while (g.tiles_used < TILE_COUNT) {
+		const int rc = play_random_move(&g, played % PLAYER_COUNT,
+			moves, &u[played]);
+		assert(rc <= 1);
+		if (rc) {
+			continue;
+		}
+		played++;
+		for (int i = 0; i < PLAYER_COUNT; ++i) {
+			assert(g.scores[i] >= last[i]);
+			last[i] = g.scores[i];
+		}
+	}
+	assert(!g.board.deck);
+	final_scores(&g, final);
+	printf("%zu tiles played. Scores %d and %d, %d and %d at the end.\n",
+		played, g.scores[0], g.scores[1], final[0], final[1]);
+	assert(final[0] >= g.scores[0] && final[1] >= g.scores[1]);
+	while (played) {
+		assert(!unplay_move(&g, u[--played]));
+	}
+	assert(!g.scores[0] && !g.scores[1]);
+	assert(g.graph.open_head == NIL && !g.graph.node_count);
+
 	for (int i = 0; i < TILE_COUNT; ++i) {
-		printf("%s\n", print_tile(deal_tile(&g), buf));
+		printf("%s\n", print_tile(id_to_tile(KIND_ID(
+			g.deck_kinds[i])), buf));
+	}
+	free_game(&g);
+	return 0;
+}
+#endif
+
+#ifdef BENCH
+/* The deck as it was dealt: Mersenne Twister seeded for it, and a double
+ * per draw scaled to the range. */
+static void seeded_deck_mt(uint64_t seed, uint8_t kinds[TILE_COUNT])
+{
+	struct mt19937_64 rng;
+	init_genrand64(&rng, seed);
+	memcpy(kinds, deck_template(), TILE_COUNT);
+	for (size_t i = TILE_COUNT - 1; i > 1; --i) {
+		const size_t j = 1 + genrand64_real2(&rng) * i;
+		const uint8_t swap = kinds[i];
+		kinds[i] = kinds[j];
+		kinds[j] = swap;
+	}
+}
+
+static double deck_ns(void (*deal)(uint64_t, uint8_t *), int decks)
+{
+	uint8_t deck[TILE_COUNT];
+	struct timespec t0, t1;
+	volatile unsigned int sink; /* So the decks can't be left out. */
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < decks; ++i) {
+		deal(i, deck);
+		sink = deck[1];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	(void)sink;
+	return ((t1.tv_sec - t0.tv_sec) * 1e9
+		+ (t1.tv_nsec - t0.tv_nsec)) / decks;
+}
+
+/* Seeded decks, each from a fresh generator as games get them: MT19937-64
+ * with doubles against seeded_deck() (make bench). Best of a few rounds
+ * each, taken in turn. */
+int main(int argc, char **argv)
+{
+	const int decks = argc > 1 ? atoi(argv[1]) : 100000;
+	double mt = 1e9, pcg = 1e9;
+	for (int i = 0; i < 10; ++i) {
+		const double m = deck_ns(seeded_deck_mt, decks);
+		const double p = deck_ns(seeded_deck, decks);
+		mt = m < mt ? m : mt;
+		pcg = p < pcg ? p : pcg;
 	}
+	printf("%d decks: %.1f ns each seeding MT19937-64, %.1f by "
+		"seeded_deck().\n", decks, mt, pcg);
 	return 0;
 }
 #endif
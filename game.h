@@ -11,41 +11,69 @@
 #include <time.h>
 
 #include <stddef.h>	/* size_t */
-#include <math.h>	/* round() */
 #include <assert.h>	/* assert() */
 #include <pthread.h>
 
 #include "limits.h"
 #include "tile.h"
 #include "board.h"
-#include "rngs/mt19937-64.h" /* Mersenne Twister PRNG. Try PCG if too slow */
+#include "graph.h"
+#include "rngs/pcg32.h"	/* PCG PRNG. */
 
-#define TILE_COUNT 72
+/* PCG streams: decks are shuffled with one, games draw from the other. */
+#define DECK_STREAM 0
+#define GAME_STREAM 1
 
 struct game {
-<<<<<<< HEAD
-	int graphs[100]; /* Placeholder for struct graph */
-=======
->>>>>>> Nick495/dev
 	struct board board;
-	struct tile tile_deck[TILE_COUNT];
-	size_t graphs_used;
+	/* The deck, in the order it's dealt. Tiles come turned the way the
+	 * catalog has them, KIND_ID(). */
+	uint8_t deck_kinds[TILE_COUNT];
+	uint8_t kinds_left[TILE_KINDS]; /* Tiles of each kind not dealt yet. */
+	struct graph graph;
 	size_t tiles_used;
-<<<<<<< HEAD
-	int scores[2];
-=======
 	int scores[PLAYER_COUNT];
-	size_t graph_indices[TILE_COUNT * TILE_COUNT * 3];
->>>>>>> Nick495/dev
+	/* The seed its deck was shuffled from (see seeded_deck()), 0 for a
+	 * deck make_game_with_deck() was given. */
+	uint64_t seed;
+	/* The game's own generator, for draws after the deal (game_rand()).
+	 * Seeded from seed however g was made. */
+	struct pcg32 rng;
 };
 
-void make_game(struct game *g);
-void make_game_with_deck(struct game *g, struct tile *deck);
-int play_move(struct game *g, struct move m, int player);
-<<<<<<< HEAD
-=======
+/* A feature scored: points to each player in players, the ones with the
+ * most tiles in it. */
+struct completion {
+	uint16_t points;
+	uint8_t players; /* Bit i for player i. */
+	uint8_t kind; /* enum feature_kind */
+};
+
+/* Everything play_move() needs to take a move back. */
+struct game_undo {
+	struct board_undo board;
+	struct graph_mark graph;
+	struct completion events[CLOSED_MAX]; /* What the move closed. */
+	size_t event_count;
+};
+
+int make_game(struct game *g);
+int make_game_seeded(struct game *g, uint64_t seed);
+void seeded_deck(uint64_t seed, uint8_t kinds[TILE_COUNT]);
+int make_game_shuffled(struct game *g, uint64_t seed,
+		const uint8_t kinds[TILE_COUNT]);
+int make_game_with_deck(struct game *g, struct tile *deck);
+void free_game(struct game *g);
+int play_move(struct game *g, struct move m, int player, struct game_undo *u);
+int play_random_move(struct game *g, int player, struct move *moves,
+		struct game_undo *u);
+int unplay_move(struct game *g, struct game_undo u);
+void final_scores(const struct game *g, int scores[PLAYER_COUNT]);
+uint64_t game_hash(const struct game *g);
 int more_tiles(struct game *g);
->>>>>>> Nick495/dev
 struct tile deal_tile(struct game *g);
+void undeal_tile(struct game *g);
+unsigned int tiles_left(const struct game *g, unsigned int kind);
+uint32_t game_rand(struct game *g, uint32_t range);
 
 #endif
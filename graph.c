@@ -0,0 +1,596 @@
+#include <assert.h>
+#include "graph.h"
+
+/* Log records a move can take, generously: linking its new nodes, the
+ * monasteries around it, and for each side, 6 closes and 3 joins. */
+#define LOG_PER_MOVE (2 * FEATURES_MAX + 3 * 8 + 4 * (6 * 3 + 3 * 6))
+
+/* Grows an array of size byte items to hold want, doubling. Returns the
+ * new array, or NULL (leaving the old one be) if out of memory. */
+static void *reserve(void *p, size_t *cap, size_t want, size_t size)
+{
+	if (want <= *cap) {
+		return p;
+	}
+	size_t n = *cap ? *cap : 16;
+	while (n < want) {
+		n *= 2;
+	}
+	void *q = realloc(p, n * size);
+	if (q) {
+		*cap = n;
+	}
+	return q;
+}
+
+static int make_room(struct graph *g, size_t nodes, size_t tiles, size_t log)
+{
+	void *p;
+	if (nodes >= NIL || tiles >= NIL) {
+		return 1; /* Numbers must stay below NIL. */
+	}
+	if (!(p = reserve(g->nodes, &g->node_cap, nodes, sizeof(*g->nodes)))) {
+		return 1;
+	}
+	g->nodes = p;
+	if (!(p = reserve(g->tiles, &g->tile_cap, tiles, sizeof(*g->tiles)))) {
+		return 1;
+	}
+	g->tiles = p;
+	if (!(p = reserve(g->log, &g->log_cap, log, sizeof(*g->log)))) {
+		return 1;
+	}
+	g->log = p;
+	return 0;
+}
+
+/* Makes an empty graph with room for a game of tiles tiles. Returns
+ * nonzero if out of memory. */
+int make_graph(struct graph *g, size_t tiles)
+{
+	memset(g, 0, sizeof(*g));
+	g->open_head = NIL;
+	/* Tiles average under 4 features. */
+	if (make_room(g, 4 * tiles, tiles, LOG_PER_MOVE)) {
+		free_graph(g);
+		return 1;
+	}
+	return 0;
+}
+
+void free_graph(struct graph *g)
+{
+	free(g->nodes);
+	free(g->tiles);
+	free(g->log);
+	memset(g, 0, sizeof(*g));
+	g->open_head = NIL;
+}
+
+/* Makes g hold nodes nodes and tiles tiles, with nothing to undo, for
+ * the caller to fill in (see load_game()). Returns 4 if out of memory. */
+int graph_resize(struct graph *g, size_t nodes, size_t tiles)
+{
+	if (make_room(g, nodes, tiles, LOG_PER_MOVE)) {
+		return 4;
+	}
+	g->node_count = nodes;
+	g->tile_count = tiles;
+	g->log_count = 0;
+	return 0;
+}
+
+unsigned int graph_find(const struct graph *g, unsigned int node)
+{
+	while (g->nodes[node].parent != node) {
+		node = g->nodes[node].parent;
+	}
+	return node;
+}
+
+/* The node segment of the tile at s is in. */
+unsigned int graph_node(const struct graph *g, const struct board *b,
+		struct slot s, unsigned int segment)
+{
+	return g->tiles[board_order(b, s)].segments[segment];
+}
+
+/* Logs node's record, about to change. */
+static struct node *touch(struct graph *g, unsigned int node)
+{
+	struct graph_log *l = &g->log[g->log_count++];
+	l->node = node;
+	l->old = g->nodes[node];
+	return &g->nodes[node];
+}
+
+/* Whether root n belongs in the list from open_head. */
+static int listed(const struct node *n)
+{
+	return n->open > 0 || n->kind == FEATURE_FIELD;
+}
+
+static void link_open(struct graph *g, unsigned int v)
+{
+	struct node *n = touch(g, v);
+	n->up = NIL;
+	n->down = g->open_head;
+	if (n->down != NIL) {
+		touch(g, n->down)->up = v;
+	}
+	g->open_head = v;
+}
+
+static void unlink_open(struct graph *g, unsigned int v)
+{
+	const unsigned int up = g->nodes[v].up, down = g->nodes[v].down;
+	if (up != NIL) {
+		touch(g, up)->down = down;
+	} else {
+		g->open_head = down;
+	}
+	if (down != NIL) {
+		touch(g, down)->up = up;
+	}
+}
+
+/* Takes one off root r's open count. */
+static void close_one(struct graph *g, unsigned int r)
+{
+	struct node *n = touch(g, r);
+	n->open--;
+	if (!listed(n)) {
+		unlink_open(g, r);
+	}
+}
+
+/* Whether any of t's nodes numbered below below is under root r. */
+static int tile_in(const struct graph *g, const struct graph_tile *t,
+		unsigned int r, unsigned int below)
+{
+	for (unsigned int w = t->first; w < below; ++w) {
+		if (graph_find(g, w) == r) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Whether node v's tile has another node of v's kind. Only such tiles
+ * can have nodes in two features that join. */
+static int has_twin(const struct graph *g, const struct graph_tile *t,
+		unsigned int v)
+{
+	for (unsigned int w = t->first; w < t->first + t->count; ++w) {
+		if (w != v && g->nodes[w].kind == g->nodes[v].kind) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Union by size, so trees stay log deep without path compression. Tiles
+ * with nodes on both sides are found walking the smaller feature's ring,
+ * and only counted once. The walk is what a join costs: a step per node of
+ * the smaller feature, and graph_find()s only at nodes has_twin(), so
+ * few. Over a game played out, union by size walks each node at most
+ * log2 of its final feature's size times; a search that plays and takes
+ * back the same join pays for its walk each time. */
+static void join(struct graph *g, unsigned int a, unsigned int b)
+{
+	unsigned int ra = graph_find(g, a), rb = graph_find(g, b);
+	if (ra == rb) {
+		return;
+	}
+	if (g->nodes[ra].size < g->nodes[rb].size) {
+		const unsigned int swap = ra;
+		ra = rb;
+		rb = swap;
+	}
+	struct node twice = { .tiles = 0 };
+	unsigned int v = rb;
+	do {
+		const struct graph_tile *t = &g->tiles[g->nodes[v].tile];
+		if (has_twin(g, t, v) && !tile_in(g, t, rb, v) &&
+				tile_in(g, t, ra, t->first + t->count)) {
+			twice.tiles++;
+			twice.shields += g->nodes[v].kind == FEATURE_CITY &&
+				t->shield;
+			twice.owned[t->player]++;
+		}
+		v = g->nodes[v].ring;
+	} while (v != rb);
+
+	if (listed(&g->nodes[rb])) {
+		unlink_open(g, rb);
+		if (!listed(&g->nodes[ra])) {
+			link_open(g, ra);
+		}
+	}
+	struct node *child = touch(g, rb);
+	struct node *root = touch(g, ra);
+	child->parent = ra;
+	root->size += child->size;
+	root->open += child->open;
+	root->tiles += child->tiles - twice.tiles;
+	root->shields += child->shields - twice.shields;
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		root->owned[i] += child->owned[i] - twice.owned[i];
+	}
+	const uint16_t ring = root->ring;
+	root->ring = child->ring;
+	child->ring = ring;
+}
+
+/* Closes the side the features on one half of a seam face it with. Each
+ * one counts once, however many of the seam's segments it has. */
+static void close_seam(struct graph *g, const uint16_t v[3])
+{
+	for (int k = 0; k < 3; ++k) {
+		if ((k < 1 || v[k] != v[0]) && (k < 2 || v[k] != v[1])) {
+			close_one(g, graph_find(g, v[k]));
+		}
+	}
+}
+
+/* Adds r to the n roots in done, unless it's there already. */
+static void add_done(uint16_t done[CLOSED_MAX], size_t *n, unsigned int r)
+{
+	size_t j = 0;
+	while (j < *n && done[j] != r) {
+		j++;
+	}
+	if (j == *n) {
+		done[(*n)++] = r;
+	}
+}
+
+/* Adds the features of the tile at s, which player must have just played
+ * on b, joining them up with its neighbours'. Writes the roots of the
+ * cities, roads and monasteries that closed to done, how many to n, and
+ * where to graph_unplace() back to to m. Returns 4 if out of memory. */
+int graph_place(struct graph *g, const struct board *b, struct slot s,
+		int player, struct graph_mark *m, uint16_t done[CLOSED_MAX],
+		size_t *n)
+{
+	const unsigned int id = board_tile(b, s);
+	struct feature f[FEATURES_MAX];
+	const unsigned int count = tile_features(id, f);
+	assert(board_order(b, s) == g->tile_count);
+	if (make_room(g, g->node_count + count, g->tile_count + 1,
+			g->log_count + LOG_PER_MOVE)) {
+		return 4;
+	}
+	m->nodes = g->node_count;
+	m->tiles = g->tile_count;
+	m->log = g->log_count;
+	m->open_head = g->open_head;
+
+	const struct slot around[8] = {
+		make_slot(s.x, s.y + 1), make_slot(s.x + 1, s.y),
+		make_slot(s.x, s.y - 1), make_slot(s.x - 1, s.y),
+		make_slot(s.x + 1, s.y + 1), make_slot(s.x + 1, s.y - 1),
+		make_slot(s.x - 1, s.y - 1), make_slot(s.x - 1, s.y + 1)
+	};
+	const unsigned int filled = board_around(b, s);
+
+	const unsigned int tile = g->tile_count++;
+	struct graph_tile *t = &g->tiles[tile];
+	for (int i = 0; i < SEGMENTS; ++i) {
+		t->segments[i] = NIL;
+	}
+	t->first = g->node_count;
+	t->count = count;
+	t->player = player;
+	t->shield = id_to_tile(id).attribute == SHIELD;
+	for (unsigned int i = 0; i < count; ++i) {
+		const unsigned int v = g->node_count++;
+		struct node *node = &g->nodes[v];
+		memset(node, 0, sizeof(*node));
+		node->parent = node->ring = v;
+		node->size = node->tiles = 1;
+		node->tile = tile;
+		node->kind = f[i].kind;
+		node->shields = f[i].kind == FEATURE_CITY && t->shield;
+		node->owned[player] = 1;
+		node->borders = f[i].borders;
+		if (f[i].kind == FEATURE_MONASTERY) {
+			node->open = 8 - filled;
+		}
+		for (int d = 0; d < 4; ++d) {
+			node->open += !!(f[i].segments & 7 << 3 * d);
+		}
+		for (uint16_t bits = f[i].segments; bits; bits &= bits - 1) {
+			t->segments[__builtin_ctz(bits)] = v;
+		}
+		if (listed(node)) {
+			link_open(g, v);
+		}
+	}
+
+	*n = 0;
+	for (int i = 0; i < 8 && filled; ++i) {
+		if (!board_tile(b, around[i])) {
+			continue;
+		}
+		const unsigned int v = graph_node(g, b, around[i],
+			CENTRE_SEGMENT);
+		if (v != NIL && g->nodes[v].kind == FEATURE_MONASTERY) {
+			close_one(g, v);
+			if (!g->nodes[v].open) {
+				add_done(done, n, v);
+			}
+		}
+	}
+	for (int d = 0; d < 4; ++d) {
+		if (!board_tile(b, around[d])) {
+			continue;
+		}
+		const uint16_t *other = g->tiles[board_order(b, around[d])]
+			.segments;
+		uint16_t mine[3], theirs[3];
+		for (int k = 0; k < 3; ++k) {
+			mine[k] = t->segments[3 * d + k];
+			theirs[k] = other[SEGMENT_ACROSS(3 * d + k)];
+		}
+		close_seam(g, mine);
+		close_seam(g, theirs);
+		for (int k = 0; k < 3; ++k) {
+			join(g, mine[k], theirs[k]);
+		}
+	}
+
+	/* Any other feature that closed touches this tile, so has one of its
+	 * nodes. */
+	for (unsigned int i = 0; i < count; ++i) {
+		const unsigned int r = graph_find(g, t->first + i);
+		if (!g->nodes[r].open && g->nodes[r].kind != FEATURE_FIELD) {
+			add_done(done, n, r);
+		}
+	}
+	return 0;
+}
+
+/* Takes the graph back to m. Undo moves in reverse order. */
+void graph_unplace(struct graph *g, struct graph_mark m)
+{
+	while (g->log_count > m.log) {
+		const struct graph_log *l = &g->log[--g->log_count];
+		g->nodes[l->node] = l->old;
+	}
+	g->node_count = m.nodes;
+	g->tile_count = m.tiles;
+	g->open_head = m.open_head;
+}
+
+/* Counts the closed cities the field node v borders that aren't marked
+ * in seen yet, and marks them. Unmarks them instead if clear. */
+static unsigned int mark_cities(const struct graph *g, unsigned int v,
+		uint8_t *seen, int clear)
+{
+	const struct node *f = &g->nodes[v];
+	const unsigned int first = g->tiles[f->tile].first;
+	unsigned int n = 0;
+	for (unsigned int b = f->borders; b; b &= b - 1) {
+		const unsigned int c = graph_find(g, first + __builtin_ctz(b));
+		if (!g->nodes[c].open && seen[c] == clear) {
+			seen[c] = !clear;
+			n++;
+		}
+	}
+	return n;
+}
+
+/* How many closed cities the field rooted at r touches, each once. Walks
+ * the field's own nodes twice, marking cities in seen as it counts them
+ * and then clearing them, so costs what the field's size does. seen is
+ * the caller's, a byte for each of g's nodes, all 0, and left that way:
+ * threads can count on the same graph with one each. */
+unsigned int graph_field_cities(const struct graph *g, unsigned int r,
+		uint8_t *seen)
+{
+	unsigned int n = 0, v = r;
+	do {
+		n += mark_cities(g, v, seen, 0);
+		v = g->nodes[v].ring;
+	} while (v != r);
+	do {
+		mark_cities(g, v, seen, 1);
+		v = g->nodes[v].ring;
+	} while (v != r);
+	return n;
+}
+
+#ifdef TEST
+/* graph_field_cities() the slow way, over every node. */
+static unsigned int field_cities(const struct graph *g, unsigned int r)
+{
+	unsigned char *seen = calloc(g->node_count, 1);
+	unsigned int n = 0;
+	assert(seen);
+	for (size_t v = 0; v < g->node_count; ++v) {
+		const struct node *f = &g->nodes[v];
+		if (graph_find(g, v) != r) {
+			continue;
+		}
+		for (unsigned int b = f->borders; b; b &= b - 1) {
+			const unsigned int c = graph_find(g,
+				g->tiles[f->tile].first + __builtin_ctz(b));
+			if (!g->nodes[c].open && !seen[c]) {
+				seen[c] = 1;
+				n++;
+			}
+		}
+	}
+	free(seen);
+	return n;
+}
+
+/* Works out every root's open count and tallies from the board, the way
+ * graph_place() doesn't, and checks them and the open list. */
+static void check_roots(const struct graph *g, const struct board *b,
+		const struct slot *placed, size_t tiles)
+{
+	static struct node want[TILE_COUNT * FEATURES_MAX];
+	static uint8_t marks[TILE_COUNT * FEATURES_MAX];
+	memset(want, 0, sizeof(want));
+	for (size_t i = 0; i < tiles; ++i) {
+		const struct slot s = placed[i];
+		const struct slot around[8] = {
+			make_slot(s.x, s.y + 1), make_slot(s.x + 1, s.y),
+			make_slot(s.x, s.y - 1), make_slot(s.x - 1, s.y),
+			make_slot(s.x + 1, s.y + 1),
+			make_slot(s.x + 1, s.y - 1),
+			make_slot(s.x - 1, s.y - 1),
+			make_slot(s.x - 1, s.y + 1)
+		};
+		const unsigned int id = board_tile(b, s);
+		const int shield = id_to_tile(id).attribute == SHIELD;
+		struct feature f[FEATURES_MAX];
+		unsigned int seen[FEATURES_MAX];
+		const unsigned int n = tile_features(id, f);
+		for (unsigned int j = 0; j < n; ++j) {
+			const unsigned int first = __builtin_ctz(f[j].segments);
+			const unsigned int r = graph_find(g,
+				graph_node(g, b, s, first));
+			unsigned int k = 0;
+			for (int d = 0; d < 8; ++d) {
+				if (board_tile(b, around[d])) {
+					continue;
+				}
+				if (f[j].kind == FEATURE_MONASTERY || (d < 4 &&
+						f[j].segments & 7 << 3 * d)) {
+					want[r].open++;
+				}
+			}
+			seen[j] = r;
+			while (k < j && seen[k] != r) {
+				k++;
+			}
+			if (k == j) {
+				want[r].tiles++;
+				want[r].shields += f[j].kind == FEATURE_CITY &&
+					shield;
+				want[r].owned[i % PLAYER_COUNT]++;
+			}
+		}
+	}
+	size_t open = 0;
+	for (size_t v = 0; v < g->node_count; ++v) {
+		const struct node *n = &g->nodes[v];
+		if (n->parent != v) {
+			continue;
+		}
+		assert(n->open == want[v].open);
+		assert(n->tiles == want[v].tiles);
+		assert(n->shields == want[v].shields);
+		assert(!memcmp(n->owned, want[v].owned, sizeof(n->owned)));
+		open += n->open > 0 || n->kind == FEATURE_FIELD;
+		if (n->kind == FEATURE_FIELD) {
+			assert(graph_field_cities(g, v, marks) ==
+				field_cities(g, v));
+		}
+	}
+	for (size_t v = 0; v < g->node_count; ++v) {
+		assert(!marks[v]);
+	}
+	unsigned int up = NIL;
+	for (unsigned int v = g->open_head; v != NIL; v = g->nodes[v].down) {
+		assert(g->nodes[v].parent == v);
+		assert(g->nodes[v].open > 0 ||
+			g->nodes[v].kind == FEATURE_FIELD);
+		assert(g->nodes[v].up == up);
+		up = v;
+		open--;
+	}
+	assert(!open);
+}
+
+static void place(struct board *b, struct graph *g, struct move m,
+		struct board_undo *bu, struct graph_mark *gm, size_t want)
+{
+	uint16_t done[CLOSED_MAX];
+	size_t n;
+	assert(!play_move_board(b, m, bu));
+	assert(!graph_place(g, b, m.slot, 0, gm, done, &n));
+	printf("(%u, %u): %zu closed", m.slot.x, m.slot.y, n);
+	for (size_t i = 0; i < n; ++i) {
+		const struct node *r = &g->nodes[done[i]];
+		printf(", %s of %u", r->kind == FEATURE_CITY ? "city" :
+			r->kind == FEATURE_ROAD ? "road" : "monastery",
+			(unsigned int) r->tiles);
+	}
+	printf(".\n");
+	assert(n == want);
+}
+
+int main(void)
+{
+	const unsigned int mid = (AXIS - 1) / 2;
+	struct board b;
+	struct graph g;
+	struct board_undo bu[TILE_COUNT];
+	struct graph_mark gm[TILE_COUNT];
+	struct slot placed[TILE_COUNT];
+	const enum edge cap[5] = { FIELD, FIELD, CITY, FIELD, FIELD };
+	const enum edge end[5] = { FIELD, ROAD, FIELD, FIELD, FIELD };
+	const enum edge cross[5] = { ROAD, ROAD, ROAD, ROAD, ROAD };
+	assert(!make_board(&b, AXIS) && !make_graph(&g, TILE_COUNT));
+
+	printf("Start tile, then close its city and road.\n");
+	place(&b, &g, make_move(id_to_tile(KIND_ID(START_KIND)),
+		make_slot(mid, mid), 0), &bu[0], &gm[0], 0);
+	place(&b, &g, make_move(make_tile(cap, NONE),
+		make_slot(mid, mid + 1), 0), &bu[1], &gm[1], 1);
+	place(&b, &g, make_move(make_tile(end, MONASTERY),
+		make_slot(mid - 1, mid), 0), &bu[2], &gm[2], 0);
+	place(&b, &g, make_move(make_tile(cross, NONE),
+		make_slot(mid + 1, mid), 0), &bu[3], &gm[3], 1);
+	const unsigned int road = graph_find(&g, graph_node(&g, &b,
+		make_slot(mid - 1, mid), 4));
+	assert(g.nodes[road].size == 3 && !g.nodes[road].open);
+	assert(road == graph_find(&g, graph_node(&g, &b,
+		make_slot(mid + 1, mid), 10)));
+	assert(road != graph_find(&g, graph_node(&g, &b,
+		make_slot(mid + 1, mid), 4)));
+	for (int i = 3; i >= 0; --i) {
+		graph_unplace(&g, gm[i]);
+		unplay_move_board(&b, bu[i]);
+	}
+	assert(!g.node_count && !g.tile_count && !g.log_count);
+
+	printf("\nA whole deck of random moves, and back.\n");
+	static struct move moves[MOVES_MAX];
+	size_t played = 0;
+	for (int d = 0; played < TILE_COUNT; ++d) {
+		struct tile t = id_to_tile(KIND_ID((d * 7) % TILE_KINDS));
+		const size_t n = generate_moves(&b, t, moves);
+		uint16_t done[CLOSED_MAX];
+		size_t closed;
+		if (!n) {
+			continue;
+		}
+		const struct move m = moves[(d * 31) % n];
+		assert(!play_move_board(&b, m, &bu[played]));
+		assert(!graph_place(&g, &b, m.slot, played % PLAYER_COUNT,
+			&gm[played], done, &closed));
+		placed[played++] = m.slot;
+		check_roots(&g, &b, placed, played);
+		for (size_t i = 0; i < closed; ++i) {
+			assert(!g.nodes[done[i]].open);
+		}
+	}
+	printf("%zu nodes, %zu log records.\n", g.node_count, g.log_count);
+	while (played) {
+		--played;
+		graph_unplace(&g, gm[played]);
+		unplay_move_board(&b, bu[played]);
+		check_roots(&g, &b, placed, played);
+	}
+	assert(!g.node_count && !g.tile_count && !g.log_count);
+
+	free_graph(&g);
+	free_board(&b);
+	return 0;
+}
+#endif
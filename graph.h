@@ -0,0 +1,86 @@
+#ifndef GRAPH_H_
+#define GRAPH_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint16_t */
+#include "tile.h"	/* features. */
+#include "board.h"	/* boards. */
+
+/* A move closes at most its own features and the monasteries around it. */
+#define CLOSED_MAX (FEATURES_MAX + 8)
+
+/* One feature of one tile, and for roots, the whole feature it's part of
+ * on the board. */
+struct node {
+	uint16_t parent; /* Itself for a root. */
+	uint16_t size; /* Nodes under a root. */
+	/* Tile sides it touches with no tile across, summed. For monasteries,
+	 * the empty cells around it instead. */
+	int16_t open;
+	uint16_t ring; /* Next node in the same feature, round and round. */
+	uint16_t up, down; /* Neighbours in the graph's list of roots. */
+	uint16_t tile; /* The order its tile was placed in. */
+	uint16_t tiles; /* Tiles under a root, each counted once. */
+	uint8_t shields; /* Of those, how many have a SHIELD. Cities only. */
+	uint8_t owned[PLAYER_COUNT]; /* And how many each player placed. */
+	uint8_t kind; /* enum feature_kind */
+	/* Fields: bit i for the city node first + i on the same tile that it
+	 * touches (see struct feature). */
+	uint8_t borders;
+};
+
+/* What the graph knows about each placed tile. */
+struct graph_tile {
+	/* segments[s] is the node segment s is in, NIL if it's in none (see
+	 * tile_features()). */
+	uint16_t segments[SEGMENTS];
+	uint16_t first; /* Its nodes are first to first + count - 1. */
+	uint8_t count;
+	uint8_t player;
+	uint8_t shield;
+};
+
+struct graph_log {
+	uint16_t node;
+	struct node old;
+};
+
+/* Union-find over the features on a board, kept in step with it one move
+ * at a time. No path compression, so every union is a few node writes
+ * that the log can take back. Roots with open > 0, and every field's, are
+ * strung together from open_head: all end of game scoring looks at. */
+struct graph {
+	struct node *nodes;
+	size_t node_count;
+	size_t node_cap;
+	struct graph_tile *tiles; /* In the order they were placed. */
+	size_t tile_count;
+	size_t tile_cap;
+	struct graph_log *log; /* Node records as they were, oldest first. */
+	size_t log_count;
+	size_t log_cap;
+	unsigned int open_head; /* NIL if the list is empty. */
+};
+
+/* Where a graph was before graph_place(), to go back to. */
+struct graph_mark {
+	size_t nodes;
+	size_t tiles;
+	size_t log;
+	unsigned int open_head;
+};
+
+int make_graph(struct graph *g, size_t tiles);
+void free_graph(struct graph *g);
+int graph_resize(struct graph *g, size_t nodes, size_t tiles);
+unsigned int graph_find(const struct graph *g, unsigned int node);
+unsigned int graph_node(const struct graph *g, const struct board *b,
+		struct slot s, unsigned int segment);
+int graph_place(struct graph *g, const struct board *b, struct slot s,
+		int player, struct graph_mark *m, uint16_t done[CLOSED_MAX],
+		size_t *n);
+void graph_unplace(struct graph *g, struct graph_mark m);
+unsigned int graph_field_cities(const struct graph *g, unsigned int r,
+		uint8_t *seen);
+
+#endif
@@ -1,11 +1,13 @@
 #ifndef LIMITS_H_
 #define LIMITS_H_
 
-<<<<<<< HEAD
-#define AXIS 77		/* AXIS by AXIS board */
-#define TILE_SZ 6	/* 1 byte per edge + ceneter + attribute */
-=======
-#define AXIS 77			/* AXIS by AXIS board */
->>>>>>> Nick495/dev
+#define AXIS 77			/* AXIS by AXIS board, see make_board() */
+#define PLAYER_COUNT 2
+/* Sizes the game's deck arrays, FRONTIER_MAX, MOVES_MAX and snapshots,
+ * so a bigger deck means a rebuild. Only boards (see make_board()) and
+ * graphs (make_graph()) take their size at run time. */
+#define TILE_COUNT 72
+/* Every move closes one open slot and opens at most 3 (4 for the first). */
+#define FRONTIER_MAX (2 * TILE_COUNT + 2)
 
 #endif
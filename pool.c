@@ -0,0 +1,186 @@
+#define _GNU_SOURCE /* SCHED_IDLE, where there is one. */
+#include "game.h"	/* seeded_deck(). First: it sets _XOPEN_SOURCE. */
+#include "pool.h"
+#include <sched.h>	/* sched_param */
+
+/* Empties p. Cell i is first filled by push number i. */
+void init_pool(struct deck_pool *p)
+{
+	for (size_t i = 0; i < POOL_SIZE; ++i) {
+		p->cells[i].seq = i;
+	}
+	p->head = p->tail = 0;
+	p->stop = 0;
+}
+
+/* Adds a copy of d. Returns 1 if p is full. */
+int pool_push(struct deck_pool *p, const struct pooled_deck *d)
+{
+	size_t pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+	struct pool_cell *c;
+	for (;;) {
+		c = &p->cells[pos & (POOL_SIZE - 1)];
+		const size_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+		const ptrdiff_t diff = (ptrdiff_t)(seq - pos);
+		if (!diff && __atomic_compare_exchange_n(&p->head, &pos,
+				pos + 1, 1, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED)) {
+			break;
+		} else if (diff < 0) {
+			return 1; /* The last lap's deck is still there. */
+		} else if (diff) {
+			pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+		} /* Else another push took the cell: the swap reloaded pos. */
+	}
+	c->deck = *d;
+	__atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* Takes the oldest deck into d. Returns 1 if p is empty. */
+int pool_pop(struct deck_pool *p, struct pooled_deck *d)
+{
+	size_t pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+	struct pool_cell *c;
+	for (;;) {
+		c = &p->cells[pos & (POOL_SIZE - 1)];
+		const size_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+		const ptrdiff_t diff = (ptrdiff_t)(seq - (pos + 1));
+		if (!diff && __atomic_compare_exchange_n(&p->tail, &pos,
+				pos + 1, 1, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED)) {
+			break;
+		} else if (diff < 0) {
+			return 1; /* Not filled yet. */
+		} else if (diff) {
+			pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+		}
+	}
+	*d = c->deck;
+	/* Free for the push a lap on. */
+	__atomic_store_n(&c->seq, pos + POOL_SIZE, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* Keeps p topped up until stop_pool(), napping while it's full. Seeds
+ * follow on from the clock, each mixed so neighbours share nothing. */
+static void *fill_pool(void *arg)
+{
+	struct deck_pool *p = arg;
+	const struct timespec nap = { 0, 1000000 };
+	struct timespec tp;
+	struct pooled_deck d;
+#ifdef SCHED_IDLE
+	const struct sched_param idle = { 0 };
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &idle);
+#endif
+	clock_gettime(CLOCK_REALTIME, &tp);
+	uint64_t n = (uint64_t)tp.tv_sec << 30 ^ tp.tv_nsec;
+	d.seed = hash_mix(n++);
+	seeded_deck(d.seed, d.kinds);
+	while (!__atomic_load_n(&p->stop, __ATOMIC_RELAXED)) {
+		if (pool_push(p, &d)) {
+			nanosleep(&nap, NULL);
+			continue;
+		}
+		d.seed = hash_mix(n++);
+		seeded_deck(d.seed, d.kinds);
+	}
+	return NULL;
+}
+
+/* Empties p and starts filling it. Returns nonzero if the thread to fill
+ * it with couldn't be made. */
+int start_pool(struct deck_pool *p)
+{
+	init_pool(p);
+	return pthread_create(&p->filler, NULL, fill_pool, p);
+}
+
+/* Stops filling p. Decks already in it can still be taken. */
+void stop_pool(struct deck_pool *p)
+{
+	__atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+	pthread_join(p->filler, NULL);
+}
+
+#ifdef TEST
+#define POPPERS 4
+#define POPS 2000
+
+static struct deck_pool pool;
+
+/* Takes POPS decks as they come and writes their seeds to arg. */
+static void *pop_decks(void *arg)
+{
+	uint64_t *seeds = arg;
+	struct pooled_deck d;
+	uint8_t kinds[TILE_COUNT];
+	for (int i = 0; i < POPS; ) {
+		if (pool_pop(&pool, &d)) {
+			sched_yield();
+			continue;
+		}
+		/* Each deck replays from its seed. */
+		seeded_deck(d.seed, kinds);
+		assert(!memcmp(kinds, d.kinds, TILE_COUNT));
+		seeds[i++] = d.seed;
+	}
+	return NULL;
+}
+
+static int compare_seeds(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+int main(void)
+{
+	static struct pooled_deck d, e;
+	static uint64_t seeds[POPPERS * POPS];
+	pthread_t poppers[POPPERS];
+
+	printf("Decks come out in order, until there are none.\n");
+	init_pool(&pool);
+	assert(pool_pop(&pool, &d));
+	for (int i = 0; i < POOL_SIZE; ++i) {
+		d.seed = i;
+		assert(!pool_push(&pool, &d));
+	}
+	assert(pool_push(&pool, &d));
+	for (int i = 0; i < POOL_SIZE; ++i) {
+		assert(!pool_pop(&pool, &e) && e.seed == (uint64_t)i);
+	}
+	assert(pool_pop(&pool, &e));
+
+	printf("%d threads take %d decks each as they're shuffled.\n",
+		POPPERS, POPS);
+	assert(!start_pool(&pool));
+	for (int i = 0; i < POPPERS; ++i) {
+		assert(!pthread_create(&poppers[i], NULL, pop_decks,
+			seeds + i * POPS));
+	}
+	for (int i = 0; i < POPPERS; ++i) {
+		pthread_join(poppers[i], NULL);
+	}
+	stop_pool(&pool);
+	/* No deck is taken twice. */
+	qsort(seeds, POPPERS * POPS, sizeof(seeds[0]), compare_seeds);
+	for (int i = 1; i < POPPERS * POPS; ++i) {
+		assert(seeds[i - 1] != seeds[i]);
+	}
+
+	/* A game made from one is the one its seed makes. */
+	static struct game g, h;
+	d.seed = 7;
+	seeded_deck(d.seed, d.kinds);
+	assert(!make_game_shuffled(&g, d.seed, d.kinds));
+	assert(!make_game_seeded(&h, 7));
+	assert(game_hash(&g) == game_hash(&h));
+	assert(!memcmp(g.deck_kinds, h.deck_kinds, TILE_COUNT));
+	free_game(&g);
+	free_game(&h);
+	return 0;
+}
+#endif
@@ -0,0 +1,46 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint64_t */
+#include <pthread.h>	/* pthread_t */
+#include "limits.h"	/* TILE_COUNT */
+
+#define POOL_SIZE 256 /* Decks kept ready. A power of 2. */
+#define CACHE_LINE 64
+
+/* A shuffled deck, and the seed that replays it (see seeded_deck()). */
+struct pooled_deck {
+	uint64_t seed;
+	uint8_t kinds[TILE_COUNT];
+};
+
+struct pool_cell {
+	size_t seq; /* Whose turn it is at the cell, see pool_push(). */
+	struct pooled_deck deck;
+};
+
+/* Decks shuffled ahead of time by a thread of their own, at the lowest
+ * priority the system gives it, so games can start without shuffling.
+ * Any number of threads can pool_pop() at once without locks: a bounded
+ * ring where each cell's seq says whether it's ready to fill or to take,
+ * and a compare and swap on head or tail claims it (D. Vyukov's MPMC
+ * queue). head and tail get cache lines of their own. */
+struct deck_pool {
+	struct pool_cell cells[POOL_SIZE];
+	char pad0[CACHE_LINE];
+	size_t head; /* Next cell to fill. */
+	char pad1[CACHE_LINE - sizeof(size_t)];
+	size_t tail; /* Next cell to take. */
+	char pad2[CACHE_LINE - sizeof(size_t)];
+	int stop;
+	pthread_t filler;
+};
+
+void init_pool(struct deck_pool *p);
+int pool_push(struct deck_pool *p, const struct pooled_deck *d);
+int pool_pop(struct deck_pool *p, struct pooled_deck *d);
+int start_pool(struct deck_pool *p);
+void stop_pool(struct deck_pool *p);
+
+#endif
@@ -1,21 +1,33 @@
 #ifndef MT19937_64_H_
 #define MT19937_64_H_
 
-void init_genrand64(unsigned long long seed);
+#define MT19937_64_NN 312
+
+/* One generator's state. Seed it with init_genrand64() or
+   init_by_array64() before drawing from it. */
+struct mt19937_64 {
+    unsigned long long mt[MT19937_64_NN]; /* The state vector */
+    int mti; /* mti==NN+1 means mt[NN] is not initialized */
+};
+
+void init_genrand64(struct mt19937_64 *r, unsigned long long seed);
+
+void init_by_array64(struct mt19937_64 *r, unsigned long long init_key[],
+		     unsigned long long key_length);
 
 /* generates a random number on [0, 2^64-1]-interval */
-unsigned long long genrand64_int64(void);
+unsigned long long genrand64_int64(struct mt19937_64 *r);
 
 /* generates a random number on [0, 2^63-1]-interval */
-long long genrand64_int63(void);
+long long genrand64_int63(struct mt19937_64 *r);
 
 /* generates a random number on [0,1]-real-interval */
-double genrand64_real1(void);
+double genrand64_real1(struct mt19937_64 *r);
 
 /* generates a random number on [0,1)-real-interval */
-double genrand64_real2(void);
+double genrand64_real2(struct mt19937_64 *r);
 
 /* generates a random number on (0,1)-real-interval */
-double genrand64_real3(void);
+double genrand64_real3(struct mt19937_64 *r);
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef PCG32_H_
+#define PCG32_H_
+
+#include <stdint.h>
+
+/* PCG-XSH-RR, after M. E. O'Neill, "PCG: A Family of Simple Fast
+ * Space-Efficient Statistically Good Algorithms for Random Number
+ * Generation" (2014), https://www.pcg-random.org. A 64-bit LCG whose
+ * output is its old state, xorshifted and turned by its top bits: 16 bytes
+ * of state, seeded in a couple of steps, where MT19937-64 needs 2.5 KB
+ * and 312 of them. Streams with different inc never overlap. */
+struct pcg32 {
+	uint64_t state;
+	uint64_t inc; /* Odd. */
+};
+
+static inline uint32_t pcg32_next(struct pcg32 *r)
+{
+	const uint64_t old = r->state;
+	r->state = old * 6364136223846793005ull + r->inc;
+	const uint32_t x = ((old >> 18) ^ old) >> 27;
+	const uint32_t rot = old >> 59;
+	return x >> rot | x << (-rot & 31);
+}
+
+static inline void pcg32_seed(struct pcg32 *r, uint64_t seed,
+		uint64_t stream)
+{
+	r->state = 0;
+	r->inc = stream << 1 | 1;
+	pcg32_next(r);
+	r->state += seed;
+	pcg32_next(r);
+}
+
+#endif
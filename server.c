@@ -1,5 +1,6 @@
 #include <stdlib.h>     /* NULL, malloc(), free() */
 #include <stdint.h>	/* uint32_t */
+#include <inttypes.h>	/* PRIu64 */
 #include <string.h>     /* memset() */
 #include <unistd.h>     /* write() */
 #include <pthread.h>	/* pthread */
@@ -9,19 +10,15 @@
 #include <netinet/in.h> /* struct sockaddr_in, struct sockaddr */
 
 #include <stdio.h>	/* DEBUG */
-<<<<<<< HEAD
-#include "limits.h"	/* AXIS, TILE_SZ */
-#include "game.h"	/* Server needs to validate moves. */
-
-struct sockaddr_in init_sockaddr(int port)
-=======
 #include <errno.h>	/* errno */
 #include "limits.h"	/* AXIS, TILE_SZ */
 #include "game.h"	/* Server needs to validate moves. */
+#include "pool.h"	/* Decks shuffled ahead of time. */
 #include "serialization.h"
 
+static struct deck_pool pool;
+
 static struct sockaddr_in init_sockaddr(int port)
->>>>>>> Nick495/dev
 {
 	struct sockaddr_in s;
 	memset(&s, '0', sizeof(s));
@@ -32,47 +29,24 @@ static struct sockaddr_in init_sockaddr(int port)
 }
 
 /* TODO: Send client hosts with sockets so that 3rd parties can't jump in */
-#define PLAYER_COUNT 2
 
-static int send_deck(int *players, size_t pcnt, struct tile *deck, size_t dlen)
+static int send_deck(int *players, size_t pcnt, const uint8_t *kinds,
+		size_t dlen)
 {
-<<<<<<< HEAD
-	char buf[TILE_SZ];
-
-	for (size_t i = 0; i < dlen; ++i) {
-		buf[0] = deck[i].edges[0];
-		buf[1] = deck[i].edges[1];
-		buf[2] = deck[i].edges[2];
-		buf[3] = deck[i].edges[3];
-		buf[4] = deck[i].edges[4];
-		buf[5] = deck[i].attribute;
-		for (size_t j = 0; j < pcnt; ++j) {
-			/* TODO: Error handling. */
-=======
 	/* TODO: Error handling */
 	unsigned char buf[TILE_SZ];
 	memset(buf, 0, sizeof(buf));
 	for (size_t i = 0; i < dlen; ++i) {
-		serialize_tile(deck[i], &buf[0]);
+		serialize_tile(id_to_tile(KIND_ID(kinds[i])), &buf[0]);
 		for (size_t j = 0; j < pcnt; ++j) {
 			printf("Sending to player %zu: ", j);
 			print_buffer(buf, sizeof(buf));
->>>>>>> Nick495/dev
 			write(players[j], buf, TILE_SZ);
 		}
 	}
 	return 0;
 }
 
-<<<<<<< HEAD
-static int send_clock(int socket, uint64_t clock)
-{
-	unsigned char buf[sizeof(clock)];
-	for (size_t j = 0; j < sizeof(clock); ++j) {
-		buf[j] = (unsigned char) (clock << (j * 8));
-	}
-	write(socket, buf, sizeof(buf));
-=======
 static int send_clock_and_order(int *players, int first, uint64_t seconds)
 {
 	/* TODO: Error handling */
@@ -129,39 +103,43 @@ static int game_over(int *players, int winner, enum reason r)
 			return 1;
 		}
 	}
->>>>>>> Nick495/dev
 	return 0;
 }
 
+/* Who's won on points, or -1 for a draw. */
+static int leader(const struct game *g)
+{
+	int scores[PLAYER_COUNT], best = 0;
+	final_scores(g, scores);
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		printf("Player %d scored %d\n", i, scores[i]);
+		best = scores[i] > scores[best] ? i : best;
+	}
+	for (int i = 0; i < PLAYER_COUNT; ++i) {
+		if (i != best && scores[i] == scores[best]) {
+			return -1;
+		}
+	}
+	return best;
+}
+
 /* Step through protocol with clients. */
 static void protocol(void *args)
 {
-<<<<<<< HEAD
-	/* Note, we should listen in a seperate thread. */
-=======
->>>>>>> Nick495/dev
 	int *hostfd = (int *)args;
 	struct game *g = malloc(sizeof(*g));
-	make_game(g);
-	listen(*hostfd, 10);
-<<<<<<< HEAD
-	printf("Listening.\n");
-
-	int players[PLAYER_COUNT] = {0};
-	for (size_t i = 0; i < PLAYER_COUNT; ++i) {
-		players[i] = accept(*hostfd, NULL, NULL);
-
-		struct timeval tm;
-		memset(&tm, 0, sizeof(tm));
-		tm.tv_sec = 5; /* 5 seconds per move timer. */
-		setsockopt(players[i], SOL_SOCKET, SO_RCVTIMEO,
-				(char *)&tm, sizeof(tm));
-
-		send_clock(players[i], tm.tv_sec);
+	struct pooled_deck d;
+	/* Shuffle here only when games start faster than the pool fills. */
+	if (!g || (pool_pop(&pool, &d) ? make_game(g) :
+			make_game_shuffled(g, d.seed, d.kinds))) {
+		printf("Out of memory for a new game.\n");
+		free(g);
+		free(hostfd);
+		return;
 	}
-	printf("Connected both players!\n");
-
-=======
+	printf("Deck seed %" PRIu64 " (make_game_seeded() replays it).\n",
+		g->seed);
+	listen(*hostfd, 10);
 
 	int current_player = 0; /* TODO: Randomly pick player to go first. */
 	int players[PLAYER_COUNT] = {0};
@@ -171,38 +149,16 @@ static void protocol(void *args)
 	if (send_clock_and_order(players, current_player, 5)) {
 		printf("Failed to send clock and order.\n");
 	}
->>>>>>> Nick495/dev
-	if (send_deck(players, PLAYER_COUNT, g->tile_deck, TILE_COUNT)) {
+	if (send_deck(players, PLAYER_COUNT, g->deck_kinds, TILE_COUNT)) {
 		printf("Failed to send deck.\n");
 	}
 
-<<<<<<< HEAD
-	/* TODO: Randomly pick player to go first. */
-	int player = 0; /* Player 0 goes first. */
-	unsigned char buf[100];
-	// prev_move = NULL
-	while (1) { /* Play game. */
-		// piece = draw_tile(game);
-		// write(players[player], (piece, prev_move))
-		// move = read(players[player], sizeof(move));
-		// if (read(players[player],&move,sizeof(move))<sizeof(move)) {
-		// 	/* player loses, player + 1 wins. */
-		// 	break;
-		// } else if (invalid_move(move)) {
-		// 	/* player loses, player + 1 wins. */
-		// 	break;
-		// }
-		// prev_move = move
-		player = (player + 1) % 2; /* Switch */
-		break;
-=======
 	unsigned char buf[1 + TILE_SZ + MOVE_SZ]; // Game_over? + tile + move
 	struct move previous;
 	while (1) { /* Play game. */
 		buf[0] = 0; /* Assume we keep playing. */
 		if (!more_tiles(g)) {
-			/* TODO: Scoring. replace 0 with high scoring player. */
-			game_over(players, 0, SCORE);
+			game_over(players, leader(g), SCORE);
 			break;
 		}
 		struct tile t = deal_tile(g);
@@ -214,17 +170,17 @@ static void protocol(void *args)
 			break;
 		}
 		struct move m = deserialize_move(buf);
-		if (!tile_eq(m.tile, t) || play_move(g, m, current_player)) {
+		if (!tile_eq(m.tile, t) || play_move(g, m, current_player, NULL)) {
 			game_over(players, current_player ^ 1, INVALID);
 			break;
 		}
 		previous = m;
 		current_player ^= 1;
->>>>>>> Nick495/dev
 	}
 	for (int i = 0; i < PLAYER_COUNT; ++i) {
 		close(players[i]);
 	}
+	free_game(g);
 	free(g);
 	free(hostfd);
         return;
@@ -240,8 +196,6 @@ static int get_socket_port(int socket)
 	return info.sin_port; /* Already in network order. */
 }
 
-<<<<<<< HEAD
-=======
 static int send_ports(int *players, size_t player_count, int port)
 {
 	/* TODO: Error handling. */
@@ -272,7 +226,6 @@ static int* assign_game_port(void)
         return hostfd;
 }
 
->>>>>>> Nick495/dev
 #define LISTEN_PORT 5000 /* Arbitrarily chosen server port. */
 int main(void)
 {
@@ -285,13 +238,14 @@ int main(void)
 	int players[PLAYER_COUNT];
 	int queued_players = 0;
 
-<<<<<<< HEAD
-=======
+	if (start_pool(&pool)) {
+		printf("No deck pool, games will shuffle their own.\n");
+	}
+
 	pthread_attr_t attr; /* Child opttions TODO REFACTOR */
 	pthread_attr_init(&attr);
 	pthread_attr_setstacksize(&attr, 4096*1024); /* 4k Is big enough */
 
->>>>>>> Nick495/dev
         while (1) {
 		/* TODO Ensure unique clients (can't play with self) */
 		players[queued_players++] = accept(listenfd, NULL, NULL);
@@ -303,29 +257,12 @@ int main(void)
 		/* Found a match. Create a child thread to host game. */
 		/* TODO: Lots of error handling. */
 		pthread_t *child = malloc(sizeof(pthread_t));
-<<<<<<< HEAD
-		pthread_detach(*child);			/* OS will free() */
-		int *hostfd = malloc(sizeof(int));	/* Thread will free() */
-		*hostfd = socket(AF_INET, SOCK_STREAM, 0);
-		struct sockaddr_in host_addr = init_sockaddr(0); // random port
-		bind(*hostfd, (struct sockaddr *)&host_addr, sizeof(host_addr));
-		pthread_create(child, NULL, &protocol, hostfd);
-		
-		/* Tell the clients where to go. */
-		uint16_t port = get_socket_port(*hostfd);
-		printf("Sending port: %u\n", ntohs(port));
-		for (int i = 0; i < PLAYER_COUNT; ++i) {
-			write(players[i], &port, sizeof(port));
-			close(players[i]); /* No longer need to talk to them. */
-		}
-=======
 		assert(child);
 		pthread_detach(*child);			/* OS will free() */
 
 		int *hostfd = assign_game_port();	/* Thread will free() */
 		send_ports(players, PLAYER_COUNT, get_socket_port(*hostfd));
 		pthread_create(child, &attr, &protocol, hostfd);
->>>>>>> Nick495/dev
 		queued_players = 0;
         }
 	close(listenfd);
@@ -0,0 +1,563 @@
+#define _XOPEN_SOURCE 600 /* mmap(), mkstemp(). The same as game.h. */
+#include "snapshot.h"
+#include <fcntl.h>	/* open() */
+#include <sys/mman.h>	/* mmap() */
+#include <sys/stat.h>	/* fstat() */
+#include <unistd.h>	/* close() */
+
+/* Where each array goes after the header, in order, 4-byte aligned. */
+static size_t align4(size_t n)
+{
+	return (n + 3) & ~(size_t) 3;
+}
+
+static int little_endian(void)
+{
+	const uint16_t one = 1;
+	return *(const unsigned char *) &one;
+}
+
+/* How big a snapshot of g is, in bytes. */
+size_t snapshot_size(const struct game *g)
+{
+	size_t n = sizeof(struct snapshot);
+	n = align4(n + TILE_COUNT);
+	n += g->board.tile_count * sizeof(struct snapshot_tile);
+	n += g->board.frontier.count * sizeof(struct snapshot_slot);
+	n += g->graph.node_count * sizeof(struct snapshot_node);
+	return n;
+}
+
+/* Writes a snapshot of g to buf, which holds len bytes and must be 8-byte
+ * aligned. Returns 1 on a big-endian host, 2 if len is too short and 4
+ * if out of memory. */
+int write_snapshot(const struct game *g, void *buf, size_t len)
+{
+	const struct board *b = &g->board;
+	const struct graph *gr = &g->graph;
+	struct snapshot *s = buf;
+	if (!little_endian()) {
+		return 1;
+	}
+	if (len < snapshot_size(g)) {
+		return 2;
+	}
+	struct slot *placed = malloc((b->tile_count + 1) * sizeof(*placed));
+	if (!placed) {
+		return 4;
+	}
+	memset(buf, 0, snapshot_size(g));
+	s->magic = SNAPSHOT_MAGIC;
+	s->version = SNAPSHOT_VERSION;
+	s->header_size = sizeof(*s);
+	s->size = snapshot_size(g);
+	s->axis = b->axis;
+	s->hash = game_hash(g);
+	memcpy(s->scores, g->scores, sizeof(s->scores));
+	s->deck_count = TILE_COUNT;
+	s->tiles_used = g->tiles_used;
+	s->tile_count = b->tile_count;
+	s->frontier_count = b->frontier.count;
+	s->node_count = gr->node_count;
+	s->open_head = gr->open_head;
+	s->deck = sizeof(*s);
+	s->tiles = align4(s->deck + TILE_COUNT);
+	s->frontier = s->tiles + s->tile_count * sizeof(struct snapshot_tile);
+	s->nodes = s->frontier +
+		s->frontier_count * sizeof(struct snapshot_slot);
+
+	uint8_t *deck = (uint8_t *) buf + s->deck;
+	for (int i = 0; i < TILE_COUNT; ++i) {
+		deck[i] = KIND_ID(g->deck_kinds[i]);
+	}
+	board_placed(b, placed);
+	struct snapshot_tile *tiles = (struct snapshot_tile *)
+		((char *) buf + s->tiles);
+	for (size_t i = 0; i < b->tile_count; ++i) {
+		const struct graph_tile *from = &gr->tiles[i];
+		struct snapshot_tile *t = &tiles[i];
+		t->slot.x = placed[i].x;
+		t->slot.y = placed[i].y;
+		t->id = board_tile(b, placed[i]);
+		t->player = from->player;
+		t->first = from->first;
+		t->count = from->count;
+		t->shield = from->shield;
+		memcpy(t->segments, from->segments, sizeof(t->segments));
+	}
+	free(placed);
+	struct snapshot_slot *frontier = (struct snapshot_slot *)
+		((char *) buf + s->frontier);
+	for (size_t i = 0; i < b->frontier.count; ++i) {
+		frontier[i].x = b->frontier.cells[i].x;
+		frontier[i].y = b->frontier.cells[i].y;
+	}
+	struct snapshot_node *nodes = (struct snapshot_node *)
+		((char *) buf + s->nodes);
+	for (size_t i = 0; i < gr->node_count; ++i) {
+		const struct node *n = &gr->nodes[i];
+		struct snapshot_node *to = &nodes[i];
+		to->parent = n->parent;
+		to->size = n->size;
+		to->open = n->open;
+		to->ring = n->ring;
+		to->up = n->up;
+		to->down = n->down;
+		to->tile = n->tile;
+		to->tiles = n->tiles;
+		to->shields = n->shields;
+		to->kind = n->kind;
+		to->borders = n->borders;
+		memcpy(to->owned, n->owned, sizeof(to->owned));
+	}
+	return 0;
+}
+
+/* Whether count items of size bytes at offset fit in s. */
+static int array_fits(const struct snapshot *s, uint32_t offset,
+		size_t count, size_t size)
+{
+	return offset % 4 == 0 && offset >= sizeof(*s) && offset <= s->size &&
+		count * size <= s->size - offset;
+}
+
+/* A node number, or NIL. */
+static int node_ok(const struct snapshot *s, unsigned int v)
+{
+	return v < s->node_count || v == NIL;
+}
+
+/* graph_find() on nodes whose parents are known to lead to roots. */
+static unsigned int node_root(const struct snapshot_node *nodes,
+		unsigned int v)
+{
+	while (nodes[v].parent != v) {
+		v = nodes[v].parent;
+	}
+	return v;
+}
+
+/* Whether the graph in s hangs together the way graph_place() builds
+ * them, so load_game() can take it as it is: each tile's nodes follow on
+ * from the last's, parents lead to roots, each feature's ring goes round
+ * its nodes once, and the open list runs through roots without looping.
+ * Nothing walking it then can run off the arrays or forever. */
+static int graph_ok(const struct snapshot *s)
+{
+	const struct snapshot_tile *tiles = snapshot_tiles(s);
+	const struct snapshot_node *nodes = snapshot_nodes(s);
+	uint8_t hit[TILE_COUNT * FEATURES_MAX] = { 0 };
+	size_t next = 0;
+	for (size_t i = 0; i < s->tile_count; ++i) {
+		const struct snapshot_tile *t = &tiles[i];
+		if (t->first != next || t->count > FEATURES_MAX) {
+			return 0;
+		}
+		next += t->count;
+		for (int k = 0; k < SEGMENTS; ++k) {
+			const unsigned int v = t->segments[k];
+			/* Only a centre can be in no feature. */
+			if (v == NIL ? k != CENTRE_SEGMENT :
+					v < t->first || v >= next) {
+				return 0;
+			}
+		}
+	}
+	if (next != s->node_count) {
+		return 0;
+	}
+	for (size_t i = 0; i < s->node_count; ++i) {
+		const struct snapshot_node *n = &nodes[i];
+		const struct snapshot_tile *t = &tiles[n->tile];
+		/* Union by size: a parent is always bigger. */
+		if (i < t->first || i >= (size_t) t->first + t->count ||
+				n->borders >> t->count || !n->size ||
+				(n->parent != i &&
+				 nodes[n->parent].size <= n->size) ||
+				hit[n->ring]++) {
+			return 0;
+		}
+	}
+	for (size_t i = 0; i < s->node_count; ++i) {
+		if (node_root(nodes, i) != node_root(nodes, nodes[i].ring)) {
+			return 0;
+		}
+	}
+	size_t listed = 0;
+	unsigned int up = NIL;
+	for (unsigned int v = s->open_head; v != NIL; v = nodes[v].down) {
+		if (nodes[v].parent != v || nodes[v].up != up ||
+				++listed > s->node_count) {
+			return 0;
+		}
+		up = v;
+	}
+	return 1;
+}
+
+/* The validation pass: checks the len bytes at p, 8-byte aligned, are a
+ * snapshot everything else here can trust, without copying anything.
+ * Returns 0 if so, 1 if it isn't a snapshot (or not one for this host),
+ * 2 if it's cut short or points outside itself, and 3 if what it holds
+ * makes no sense. */
+int check_snapshot(const void *p, size_t len)
+{
+	const struct snapshot *s = p;
+	if (!little_endian() || (uintptr_t) p % 8 || len < sizeof(*s) ||
+			sizeof(struct snapshot_tile) != 36 ||
+			sizeof(struct snapshot_node) != 24) {
+		return 1;
+	}
+	if (s->magic != SNAPSHOT_MAGIC || s->version != SNAPSHOT_VERSION ||
+			s->header_size != sizeof(*s)) {
+		return 1;
+	}
+	if (s->size > len || s->size < sizeof(*s) ||
+			!array_fits(s, s->deck, s->deck_count, 1) ||
+			!array_fits(s, s->tiles, s->tile_count,
+				sizeof(struct snapshot_tile)) ||
+			!array_fits(s, s->frontier, s->frontier_count,
+				sizeof(struct snapshot_slot)) ||
+			!array_fits(s, s->nodes, s->node_count,
+				sizeof(struct snapshot_node))) {
+		return 2;
+	}
+	if (s->deck_count != TILE_COUNT || s->tiles_used > s->deck_count ||
+			s->tile_count > s->tiles_used ||
+			s->frontier_count > FRONTIER_MAX ||
+			s->node_count > s->tile_count * FEATURES_MAX ||
+			!node_ok(s, s->open_head) || !s->axis) {
+		return 3;
+	}
+	const uint8_t *deck = snapshot_deck(s);
+	for (size_t i = 0; i < s->deck_count; ++i) {
+		if (!deck[i] || deck[i] >= TILE_IDS) {
+			return 3;
+		}
+	}
+	const struct snapshot_tile *tiles = snapshot_tiles(s);
+	for (size_t i = 0; i < s->tile_count; ++i) {
+		const struct snapshot_tile *t = &tiles[i];
+		if (t->slot.x >= s->axis || t->slot.y >= s->axis ||
+				!t->id || t->id >= TILE_IDS ||
+				t->player >= PLAYER_COUNT ||
+				t->first + t->count > s->node_count) {
+			return 3;
+		}
+		for (int k = 0; k < SEGMENTS; ++k) {
+			if (!node_ok(s, t->segments[k])) {
+				return 3;
+			}
+		}
+	}
+	const struct snapshot_slot *frontier = snapshot_frontier(s);
+	for (size_t i = 0; i < s->frontier_count; ++i) {
+		if (frontier[i].x >= s->axis || frontier[i].y >= s->axis) {
+			return 3;
+		}
+	}
+	const struct snapshot_node *nodes = snapshot_nodes(s);
+	for (size_t i = 0; i < s->node_count; ++i) {
+		const struct snapshot_node *n = &nodes[i];
+		if (n->parent >= s->node_count || n->ring >= s->node_count ||
+				!node_ok(s, n->up) || !node_ok(s, n->down) ||
+				n->tile >= s->tile_count || !n->kind ||
+				n->kind > FEATURE_MONASTERY) {
+			return 3;
+		}
+	}
+	return graph_ok(s) ? 0 : 3;
+}
+
+const uint8_t *snapshot_deck(const struct snapshot *s)
+{
+	return (const uint8_t *) s + s->deck;
+}
+
+const struct snapshot_tile *snapshot_tiles(const struct snapshot *s)
+{
+	return (const void *) ((const char *) s + s->tiles);
+}
+
+const struct snapshot_slot *snapshot_frontier(const struct snapshot *s)
+{
+	return (const void *) ((const char *) s + s->frontier);
+}
+
+const struct snapshot_node *snapshot_nodes(const struct snapshot *s)
+{
+	return (const void *) ((const char *) s + s->nodes);
+}
+
+/* Makes g the game checked snapshot s was taken of, to play on: deals
+ * its deck as far as it went, puts its tiles back on the board, and
+ * takes its graph and scores as they are. Returns 3 if the tiles don't
+ * go down where s has them, leaving the frontier s saved, or the game
+ * doesn't hash to what s says, 4 if out of memory. free_game() when done,
+ * unless it fails. */
+int load_game(struct game *g, const struct snapshot *s)
+{
+	struct tile deck[TILE_COUNT];
+	const uint8_t *ids = snapshot_deck(s);
+	const struct snapshot_tile *tiles = snapshot_tiles(s);
+	const struct snapshot_slot *frontier = snapshot_frontier(s);
+	const struct snapshot_node *nodes = snapshot_nodes(s);
+	struct board *b = &g->board;
+	struct graph *gr = &g->graph;
+	int rc = 0;
+	if (s->axis != AXIS) {
+		return 3;
+	}
+	for (int i = 0; i < TILE_COUNT; ++i) {
+		deck[i] = id_to_tile(ids[i]);
+	}
+	rc = make_game_with_deck(g, deck);
+	if (rc) {
+		return rc == 2 ? 3 : 4;
+	}
+	while (g->tiles_used < s->tiles_used) {
+		deal_tile(g);
+	}
+	/* The board only: the graph comes as it is. */
+	for (size_t i = 0; i < s->tile_count && !rc; ++i) {
+		const struct snapshot_tile *t = &tiles[i];
+		rc = play_move_board(b, make_move(id_to_tile(t->id),
+			make_slot(t->slot.x, t->slot.y), 0), NULL);
+	}
+	if (!rc) {
+		rc = graph_resize(gr, s->node_count, s->tile_count);
+	}
+	if (rc) {
+		free_game(g);
+		return rc == 4 ? 4 : 3;
+	}
+	rc = b->frontier.count != s->frontier_count;
+	for (size_t i = 0; i < s->frontier_count && !rc; ++i) {
+		rc = frontier[i].x != b->frontier.cells[i].x ||
+			frontier[i].y != b->frontier.cells[i].y;
+	}
+	if (rc) {
+		free_game(g);
+		return 3;
+	}
+	for (size_t i = 0; i < s->tile_count; ++i) {
+		const struct snapshot_tile *from = &tiles[i];
+		struct graph_tile *t = &gr->tiles[i];
+		t->player = from->player;
+		t->first = from->first;
+		t->count = from->count;
+		t->shield = from->shield;
+		memcpy(t->segments, from->segments, sizeof(t->segments));
+	}
+	for (size_t i = 0; i < s->node_count; ++i) {
+		const struct snapshot_node *from = &nodes[i];
+		struct node *n = &gr->nodes[i];
+		n->parent = from->parent;
+		n->size = from->size;
+		n->open = from->open;
+		n->ring = from->ring;
+		n->up = from->up;
+		n->down = from->down;
+		n->tile = from->tile;
+		n->tiles = from->tiles;
+		n->shields = from->shields;
+		n->kind = from->kind;
+		n->borders = from->borders;
+		memcpy(n->owned, from->owned, sizeof(n->owned));
+	}
+	gr->open_head = s->open_head;
+	memcpy(g->scores, s->scores, sizeof(g->scores));
+	if (game_hash(g) != s->hash) {
+		free_game(g);
+		return 3;
+	}
+	return 0;
+}
+
+/* Writes a snapshot of g to the file at path. Returns nonzero on
+ * failure. */
+int save_snapshot(const struct game *g, const char *path)
+{
+	const size_t len = snapshot_size(g);
+	uint64_t *buf = malloc(len); /* 8-byte aligned. */
+	FILE *f;
+	int rc = !buf || write_snapshot(g, buf, len);
+	if (!rc && (f = fopen(path, "wb"))) {
+		rc = fwrite(buf, 1, len, f) != len;
+		rc |= fclose(f) != 0;
+	} else {
+		rc = 1;
+	}
+	free(buf);
+	return rc;
+}
+
+/* Maps the snapshot file at path and checks it (see check_snapshot(),
+ * whose codes it returns, or 5 if the file can't be read). unmap_snapshot()
+ * when done. */
+int map_snapshot(struct snapshot_file *f, const char *path)
+{
+	struct stat st;
+	const int fd = open(path, O_RDONLY);
+	void *p;
+	int rc;
+	f->s = NULL;
+	f->len = 0;
+	if (fd < 0) {
+		return 5;
+	}
+	if (fstat(fd, &st)) {
+		close(fd);
+		return 5;
+	}
+	if (st.st_size < (off_t) sizeof(struct snapshot)) {
+		close(fd);
+		return 2;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); /* The mapping holds on to the file. */
+	if (p == MAP_FAILED) {
+		return 5;
+	}
+	if ((rc = check_snapshot(p, st.st_size))) {
+		munmap(p, st.st_size);
+		return rc;
+	}
+	f->s = p;
+	f->len = st.st_size;
+	return 0;
+}
+
+void unmap_snapshot(struct snapshot_file *f)
+{
+	if (f->s) {
+		munmap((void *) f->s, f->len);
+	}
+	f->s = NULL;
+	f->len = 0;
+}
+
+#ifdef TEST
+int main(void)
+{
+	const unsigned int mid = (AXIS - 1) / 2;
+	static struct move moves[MOVES_MAX];
+	struct game g, h;
+	assert(!make_game(&g));
+	while (g.tiles_used < TILE_COUNT / 2) {
+		assert(play_random_move(&g, g.board.tile_count % PLAYER_COUNT,
+			moves, NULL) <= 1);
+	}
+
+	const size_t len = snapshot_size(&g);
+	uint64_t *buf = malloc(len), *copy = malloc(len);
+	assert(buf && copy && !write_snapshot(&g, buf, len));
+	printf("%zu tiles, %zu nodes: a %zu byte snapshot.\n",
+		g.board.tile_count, g.graph.node_count, len);
+	assert(!check_snapshot(buf, len));
+	assert(check_snapshot(buf, len - 1) == 2);
+	assert(check_snapshot((char *) buf + 4, len - 4) == 1);
+
+	printf("Anything off gets caught.\n");
+	struct snapshot *s = (struct snapshot *) copy;
+	memcpy(copy, buf, len);
+	s->version++;
+	assert(check_snapshot(copy, len) == 1);
+	memcpy(copy, buf, len);
+	s->nodes = s->size - 1;
+	assert(check_snapshot(copy, len) == 2);
+	memcpy(copy, buf, len);
+	((uint8_t *) copy)[s->deck + 5] = TILE_IDS;
+	assert(check_snapshot(copy, len) == 3);
+	memcpy(copy, buf, len);
+	((struct snapshot_node *) ((char *) copy + s->nodes))->parent =
+		s->node_count;
+	assert(check_snapshot(copy, len) == 3);
+	memcpy(copy, buf, len);
+	s->scores[0]++; /* Checks out, but won't load. */
+	assert(!check_snapshot(copy, len));
+	assert(load_game(&h, s) == 3);
+	memcpy(copy, buf, len);
+	struct snapshot_slot *slots = (struct snapshot_slot *)
+		((char *) copy + s->frontier);
+	const struct snapshot_slot swap = slots[0];
+	slots[0] = slots[1];
+	slots[1] = swap;
+	assert(!check_snapshot(copy, len));
+	assert(load_game(&h, s) == 3);
+	/* A graph that would send walks round in circles. */
+	struct snapshot_node *nodes = (struct snapshot_node *)
+		((char *) copy + s->nodes);
+	memcpy(copy, buf, len);
+	unsigned int v = 0;
+	while (nodes[v].ring == v) {
+		v++;
+	}
+	nodes[v].ring = v;
+	assert(check_snapshot(copy, len) == 3);
+	memcpy(copy, buf, len);
+	v = 0;
+	while (nodes[v].parent == v) {
+		v++;
+	}
+	nodes[nodes[v].parent].parent = v;
+	assert(check_snapshot(copy, len) == 3);
+	memcpy(copy, buf, len);
+	nodes[s->open_head].up = s->open_head;
+	assert(check_snapshot(copy, len) == 3);
+
+	printf("Loading it gives the same game back.\n");
+	assert(!load_game(&h, (const struct snapshot *) buf));
+	assert(game_hash(&h) == game_hash(&g));
+	assert(snapshot_size(&h) == len && !write_snapshot(&h, copy, len));
+	assert(!memcmp(buf, copy, len));
+	/* And plays on the same. */
+	{
+		static struct game_undo u[TILE_COUNT];
+		const size_t used = g.tiles_used;
+		size_t played = 0;
+		int a[PLAYER_COUNT], b[PLAYER_COUNT];
+		h.rng = g.rng; /* Not saved: so they pick the same moves. */
+		while (g.tiles_used < TILE_COUNT) {
+			const int p = played % PLAYER_COUNT;
+			const int rc = play_random_move(&g, p, moves,
+				&u[played]);
+			assert(rc <= 1 && play_random_move(&h, p, moves,
+				NULL) == rc);
+			assert(game_hash(&g) == game_hash(&h));
+			played += !rc;
+		}
+		final_scores(&g, a);
+		final_scores(&h, b);
+		assert(!memcmp(a, b, sizeof(a)));
+		while (played) {
+			assert(!unplay_move(&g, u[--played]));
+		}
+		while (g.tiles_used > used) {
+			undeal_tile(&g);
+		}
+	}
+	free_game(&h);
+
+	printf("And so does mapping it from a file.\n");
+	char path[] = "/tmp/snapshot-XXXXXX";
+	struct snapshot_file f;
+	const int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+	assert(!save_snapshot(&g, path));
+	assert(!map_snapshot(&f, path));
+	assert(f.len == len && !memcmp(f.s, buf, len));
+	assert(snapshot_tiles(f.s)[0].slot.x == mid);
+	assert(!load_game(&h, f.s) && game_hash(&h) == game_hash(&g));
+	unmap_snapshot(&f);
+	remove(path);
+	assert(map_snapshot(&f, path) == 5);
+
+	free_game(&h);
+	free_game(&g);
+	free(buf);
+	free(copy);
+	return 0;
+}
+#endif
@@ -0,0 +1,84 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint16_t */
+#include "game.h"	/* games. */
+
+#define SNAPSHOT_MAGIC 0x70616e73 /* "snap" as it sits in the file. */
+#define SNAPSHOT_VERSION 1
+
+/* A saved game, made to be read where it lies, straight out of mmap(),
+ * once check_snapshot() has passed it. Fields are fixed width and
+ * little-endian, with no padding the compiler adds: every struct's size
+ * is a multiple of 4, and arrays sit at 4-byte aligned offsets from the
+ * start of the header. Big-endian hosts refuse snapshots outright. */
+struct snapshot {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size; /* sizeof(struct snapshot), 64. */
+	uint32_t size; /* Header and arrays, in bytes. */
+	uint32_t axis;
+	uint64_t hash; /* game_hash() of the game saved. */
+	int32_t scores[PLAYER_COUNT];
+	uint16_t deck_count;
+	uint16_t tiles_used;
+	uint16_t tile_count; /* Tiles placed. */
+	uint16_t frontier_count;
+	uint16_t node_count;
+	uint16_t open_head; /* See struct graph. */
+	uint32_t deck; /* Offset of uint8_t ids[deck_count]. */
+	uint32_t tiles; /* Of struct snapshot_tile[tile_count], in order. */
+	uint32_t frontier; /* Of struct snapshot_slot[frontier_count]. */
+	uint32_t nodes; /* Of struct snapshot_node[node_count]. */
+	uint32_t reserved;
+};
+
+struct snapshot_slot {
+	uint16_t x, y;
+};
+
+/* A placed tile, and what the graph knows of it (see struct graph_tile).
+ * 36 bytes. */
+struct snapshot_tile {
+	struct snapshot_slot slot;
+	uint8_t id;
+	uint8_t player;
+	uint16_t first;
+	uint8_t count;
+	uint8_t shield;
+	uint16_t segments[SEGMENTS];
+};
+
+/* A graph node, see struct node. 24 bytes. */
+struct snapshot_node {
+	uint16_t parent, size;
+	int16_t open;
+	uint16_t ring, up, down;
+	uint16_t tile, tiles;
+	uint8_t shields;
+	uint8_t kind;
+	uint8_t borders;
+	uint8_t owned[PLAYER_COUNT];
+	uint8_t pad[3];
+};
+
+/* A snapshot file, mapped. */
+struct snapshot_file {
+	const struct snapshot *s;
+	size_t len;
+};
+
+size_t snapshot_size(const struct game *g);
+int write_snapshot(const struct game *g, void *buf, size_t len);
+int check_snapshot(const void *p, size_t len);
+const uint8_t *snapshot_deck(const struct snapshot *s);
+const struct snapshot_tile *snapshot_tiles(const struct snapshot *s);
+const struct snapshot_slot *snapshot_frontier(const struct snapshot *s);
+const struct snapshot_node *snapshot_nodes(const struct snapshot *s);
+int load_game(struct game *g, const struct snapshot *s);
+int save_snapshot(const struct game *g, const char *path);
+int map_snapshot(struct snapshot_file *f, const char *path);
+void unmap_snapshot(struct snapshot_file *f);
+
+#endif
@@ -1,22 +1,70 @@
+#include <assert.h>
+#include "limits.h"	/* TILE_COUNT */
 #include "tile.h"
 
-<<<<<<< HEAD
-=======
+/* Tileset: http://russcon.org/RussCon/carcassonne/tiles.html
+ * Kind, top, right, bottom, left, center, attribute, copies in the deck.
+ * Kinds count up from 0 and the start tile's must come first
+ * (START_KIND). */
+#define CATALOG(X) \
+	X(0,  CITY,  ROAD,  FIELD, ROAD,  ROAD,  NONE,      4) \
+	X(1,  CITY,  CITY,  CITY,  CITY,  CITY,  SHIELD,    1) \
+	X(2,  ROAD,  ROAD,  ROAD,  ROAD,  ROAD,  NONE,      1) \
+	X(3,  CITY,  CITY,  FIELD, CITY,  CITY,  NONE,      3) \
+	X(4,  CITY,  CITY,  FIELD, CITY,  CITY,  SHIELD,    1) \
+	X(5,  CITY,  CITY,  ROAD,  CITY,  CITY,  NONE,      1) \
+	X(6,  CITY,  CITY,  ROAD,  CITY,  CITY,  SHIELD,    2) \
+	X(7,  FIELD, ROAD,  ROAD,  ROAD,  ROAD,  NONE,      4) \
+	X(8,  FIELD, CITY,  FIELD, CITY,  CITY,  NONE,      1) \
+	X(9,  FIELD, CITY,  FIELD, CITY,  CITY,  SHIELD,    2) \
+	X(10, ROAD,  FIELD, ROAD,  FIELD, ROAD,  NONE,      8) \
+	X(11, CITY,  ROAD,  ROAD,  CITY,  CITY,  NONE,      3) \
+	X(12, CITY,  ROAD,  ROAD,  CITY,  CITY,  SHIELD,    2) \
+	X(13, CITY,  FIELD, FIELD, CITY,  CITY,  NONE,      3) \
+	X(14, CITY,  FIELD, FIELD, CITY,  CITY,  SHIELD,    2) \
+	X(15, FIELD, FIELD, ROAD,  ROAD,  ROAD,  NONE,      9) \
+	X(16, CITY,  CITY,  FIELD, FIELD, FIELD, NONE,      2) \
+	X(17, FIELD, CITY,  FIELD, CITY,  FIELD, NONE,      3) \
+	X(18, FIELD, FIELD, ROAD,  FIELD, FIELD, MONASTERY, 2) \
+	X(19, FIELD, FIELD, FIELD, FIELD, FIELD, MONASTERY, 4) \
+	X(20, CITY,  FIELD, FIELD, FIELD, FIELD, NONE,      5) \
+	X(21, CITY,  ROAD,  ROAD,  FIELD, ROAD,  NONE,      3) \
+	X(22, CITY,  FIELD, ROAD,  ROAD,  ROAD,  NONE,      3) \
+	X(23, CITY,  ROAD,  ROAD,  ROAD,  ROAD,  NONE,      3)
+
+#define PACK(t, r, b, l, c, a) \
+	((t) | (r) << 2 | (b) << 4 | (l) << 6 | (c) << 8 | (a) << 10)
+#define ROTATIONS(k, t, r, b, l, c, a, n) \
+	PACK(t, r, b, l, c, a), PACK(l, t, r, b, c, a), \
+	PACK(b, l, t, r, c, a), PACK(r, b, l, t, c, a),
+/* How many rotations it takes to get back to the same tile. */
+#define PERIOD(k, t, r, b, l, c, a, n) \
+	((t) == (r) && (r) == (b) && (b) == (l) ? 1 : \
+	 (t) == (b) && (r) == (l) ? 2 : 4),
+#define COUNT(k, t, r, b, l, c, a, n) n,
+/* Kind k, n times over. No kind has more than 9 copies. */
+#define COPIES_1(k) k,
+#define COPIES_2(k) COPIES_1(k) k,
+#define COPIES_3(k) COPIES_2(k) k,
+#define COPIES_4(k) COPIES_3(k) k,
+#define COPIES_5(k) COPIES_4(k) k,
+#define COPIES_6(k) COPIES_5(k) k,
+#define COPIES_7(k) COPIES_6(k) k,
+#define COPIES_8(k) COPIES_7(k) k,
+#define COPIES_9(k) COPIES_8(k) k,
+#define DECK(k, t, r, b, l, c, a, n) COPIES_##n(k)
+
+static const uint16_t packed_ids[TILE_IDS] = { 0, CATALOG(ROTATIONS) };
+static const unsigned char periods[TILE_KINDS] = { CATALOG(PERIOD) };
+static const uint8_t counts[TILE_KINDS] = { CATALOG(COUNT) };
+/* The kinds of every tile in the deck, catalog order. */
+static const uint8_t deck_kinds[TILE_COUNT] = { CATALOG(DECK) };
+
 int tile_eq(struct tile a, struct tile b)
 {
-	for (int i = 0; i < 5; ++i) {
-		if (a.edges[i] != b.edges[i]) {
-			return 0;
-		}
-	}
-	if (a.attribute != b.attribute) {
-		return 0;
-	} else {
-		return 1;
-	}
+	return pack_tile(a) == pack_tile(b);
 }
 
->>>>>>> Nick495/dev
 struct tile make_tile(const enum edge edges[5], enum attribute a)
 {
 	struct tile t;
@@ -27,14 +75,335 @@ struct tile make_tile(const enum edge edges[5], enum attribute a)
 
 struct tile rotate_tile(const struct tile old, const int rotation)
 {
-	enum edge new[5];
-	new[4] = old.edges[4]; /* Center doesn't move. */
-	
-	/* Clockwise rotation moves previous elements up, so we go backwards. */
-	for (unsigned int i = 4; i > 0; --i) { /* Need unsigned for wrapping */
-		new[i - 1] = old.edges[(i - 1 - rotation) % 4];
+	return unpack_tile(rotate_packed(pack_tile(old), rotation));
+}
+
+/* Clockwise rotation moves each side's 2 bits up one side, wrapping the
+ * left side around to the top. Center and attribute don't move. */
+uint16_t rotate_packed(uint16_t p, int rotation)
+{
+	const unsigned int shift = 2 * (rotation & 3);
+	const unsigned int sides = p & 0xff;
+	return (p & ~0xff) | ((sides << shift | sides >> (8 - shift)) & 0xff);
+}
+
+uint16_t pack_tile(struct tile t)
+{
+	uint16_t p = t.attribute << 10;
+	for (int i = 0; i < 5; ++i) {
+		p |= t.edges[i] << (2 * i);
+	}
+	return p;
+}
+
+struct tile unpack_tile(uint16_t p)
+{
+	struct tile t;
+	for (int i = 0; i < 5; ++i) {
+		t.edges[i] = PACKED_EDGE(p, i);
+	}
+	t.attribute = PACKED_ATTRIBUTE(p);
+	return t;
+}
+
+
+struct tile id_to_tile(unsigned int id)
+{
+	return unpack_tile(packed_ids[id]);
+}
+
+uint16_t id_packed(unsigned int id)
+{
+	return packed_ids[id];
+}
+
+/* Symmetric tiles repeat, so fold the rotation back onto its period. */
+unsigned int rotate_id(unsigned int id, int rotation)
+{
+	if (!id) {
+		return 0;
+	}
+	const unsigned int k = ID_KIND(id);
+	return KIND_ID(k) + (ID_ROTATION(id) + (rotation & 3)) % 4 % periods[k];
+}
+
+unsigned int kind_count(unsigned int kind)
+{
+	return counts[kind];
+}
+
+/* kind_count() of every kind, for a whole deck's counts at once. */
+const uint8_t *kind_counts(void)
+{
+	return counts;
+}
+
+/* Only the sides sig constrains have to match. */
+int id_fits(unsigned int id, unsigned int sig)
+{
+	unsigned int care = (sig | sig >> 1) & 0x55;
+	care |= care << 1;
+	return id && !((packed_ids[id] ^ sig) & care);
+}
+
+/* Canonical ids fitting each signature, back to back: fit_ids from
+ * fit_start[sig] up to fit_start[sig + 1]. The same the other way round
+ * for the signatures some rotation of each kind fits. Each id's mirror
+ * image, and each kind's features. How many tiles of a full deck fit
+ * each signature, some way round. The id of every packed tile, 0 if it's
+ * in no kind. Filled in once, on first use. */
+static uint16_t fit_start[SIGNATURES + 1];
+static uint8_t fit_ids[SIGNATURES * (TILE_IDS - 1)];
+static uint16_t kind_start[TILE_KINDS + 1];
+static uint8_t kind_sigs[TILE_KINDS * SIGNATURES];
+static uint8_t mirrors[TILE_IDS];
+static struct feature features[TILE_KINDS][FEATURES_MAX];
+static unsigned char feature_counts[TILE_KINDS];
+static uint16_t deck_fits[SIGNATURES];
+static uint8_t packed_to_id[1 << 12]; /* Edges and attribute: 12 bits. */
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+/* Whether side segments i and j are joined by an arc of the edge that
+ * wall's segments aren't on. */
+static int same_side(unsigned int i, unsigned int j, uint16_t wall)
+{
+	uint16_t between = 0;
+	for (unsigned int s = (i + 1) % 12; s != j; s = (s + 1) % 12) {
+		between |= 1 << s;
+	}
+	const uint16_t rest = 0xfff & ~between & ~(1 << i | 1 << j);
+	return !(wall & between) || !(wall & rest);
+}
+
+static void add_feature(unsigned int k, uint16_t segments,
+		enum feature_kind kind)
+{
+	struct feature *f = &features[k][feature_counts[k]++];
+	f->segments = segments;
+	f->kind = kind;
+	f->borders = 0;
+}
+
+/* Works out kind k's features from its edges, unrotated. */
+static void build_features(unsigned int k)
+{
+	const uint16_t p = packed_ids[KIND_ID(k)];
+	const enum edge centre = PACKED_EDGE(p, 4);
+	uint16_t city = 0, road = 0, field = 0, walls[5];
+	unsigned int roads = 0, n = 0;
+	for (unsigned int d = 0; d < 4; ++d) {
+		switch (PACKED_EDGE(p, d)) {
+		case CITY:
+			city |= 7 << 3 * d;
+			break;
+		case ROAD:
+			road |= 2 << 3 * d;
+			field |= 5 << 3 * d;
+			roads++;
+			break;
+		default:
+			field |= 7 << 3 * d;
+		}
 	}
-	return make_tile(new, old.attribute);
+	/* City sides join through a city centre, else each is its own cap. */
+	if (centre == CITY) {
+		add_feature(k, city | CENTRE_BIT, FEATURE_CITY);
+		walls[n++] = city;
+	} else {
+		for (unsigned int d = 0; d < 4; ++d) {
+			if (city & 7 << 3 * d) {
+				add_feature(k, 7 << 3 * d, FEATURE_CITY);
+			}
+		}
+	}
+	/* Two road ends make one road. One end stops at whatever is in the
+	 * middle, and three or four stop where they meet. Either way more
+	 * than one end fences fields off from each other. */
+	if (roads == 2) {
+		add_feature(k, road | (centre == ROAD ? CENTRE_BIT : 0),
+			FEATURE_ROAD);
+	} else {
+		for (uint16_t r = road; r; r &= r - 1) {
+			add_feature(k, r & -r, FEATURE_ROAD);
+		}
+	}
+	if (roads > 1) {
+		walls[n++] = road;
+	}
+	/* A field is the segments no wall separates. */
+	while (field) {
+		const unsigned int i = __builtin_ctz(field);
+		uint16_t f = 0;
+		for (uint16_t m = field; m; m &= m - 1) {
+			const unsigned int j = __builtin_ctz(m);
+			unsigned int w = 0;
+			while (w < n && same_side(i, j, walls[w])) {
+				w++;
+			}
+			f |= (w == n) << j;
+		}
+		add_feature(k, f, FEATURE_FIELD);
+		field &= ~f;
+	}
+	if (PACKED_ATTRIBUTE(p) == MONASTERY) {
+		add_feature(k, CENTRE_BIT, FEATURE_MONASTERY);
+	}
+	assert(feature_counts[k] <= FEATURES_MAX);
+	/* A field touches the cities next to it going round the edge. */
+	for (unsigned int i = 0; i < feature_counts[k]; ++i) {
+		struct feature *f = &features[k][i];
+		const uint16_t e = f->segments & 0xfff;
+		const uint16_t next = (e << 1 | e >> 11 | e >> 1 | e << 11)
+			& 0xfff;
+		for (unsigned int j = 0; j < feature_counts[k]; ++j) {
+			if (f->kind == FEATURE_FIELD &&
+					features[k][j].kind == FEATURE_CITY &&
+					next & features[k][j].segments) {
+				f->borders |= 1 << j;
+			}
+		}
+	}
+}
+
+static void build_tables(void)
+{
+	size_t n = 0;
+	/* Rotations are stored in order, so the lowest id is canonical. */
+	for (unsigned int id = TILE_IDS - 1; id > 0; --id) {
+		packed_to_id[packed_ids[id]] = id;
+	}
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		build_features(k);
+	}
+	for (unsigned int id = 1; id < TILE_IDS; ++id) {
+		const uint16_t p = packed_ids[id];
+		/* Swap the right and left edges. */
+		const uint16_t m = (p & ~0xcc) | (p & 0x0c) << 4
+			| (p & 0xc0) >> 4;
+		mirrors[id] = packed_to_id[m];
+		/* Every chiral kind's mirror image is in the deck too. */
+		assert(mirrors[id]);
+	}
+	for (unsigned int sig = 0; sig < SIGNATURES; ++sig) {
+		fit_start[sig] = n;
+		for (unsigned int id = 1; id < TILE_IDS; ++id) {
+			if (rotate_id(id, 0) == id && id_fits(id, sig)) {
+				fit_ids[n++] = id;
+			}
+		}
+	}
+	fit_start[SIGNATURES] = n;
+	n = 0;
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		kind_start[k] = n;
+		for (unsigned int sig = 0; sig < SIGNATURES; ++sig) {
+			const unsigned int id = KIND_ID(k);
+			int r = 0;
+			while (r < 4 && !id_fits(rotate_id(id, r), sig)) {
+				r++;
+			}
+			if (r < 4) {
+				kind_sigs[n++] = sig;
+			}
+		}
+	}
+	kind_start[TILE_KINDS] = n;
+	n = 0;
+	for (unsigned int k = 0; k < TILE_KINDS; ++k) {
+		for (size_t i = kind_start[k]; i < kind_start[k + 1]; ++i) {
+			deck_fits[kind_sigs[i]] += counts[k];
+		}
+		n += counts[k];
+	}
+	/* Or deck_kinds ends in zeros: more start tiles. */
+	assert(n == TILE_COUNT);
+}
+
+/* Returns the canonical id of t, or 0 if t isn't in the catalog. */
+unsigned int tile_to_id(struct tile t)
+{
+	unsigned int bad = t.attribute;
+	pthread_once(&tables_once, build_tables);
+	for (int i = 0; i < 5; ++i) {
+		bad |= t.edges[i];
+	}
+	/* Anything over 2 bits would pack into its neighbours. */
+	return bad > 3 ? 0 : packed_to_id[pack_tile(t)];
+}
+
+/* The id of id's mirror image, flipped left to right. */
+unsigned int mirror_id(unsigned int id)
+{
+	pthread_once(&tables_once, build_tables);
+	return mirrors[id];
+}
+
+/* Tile id under board symmetry k: mirrored if k & 4 (see mirror_id()),
+ * then turned a quarter clockwise k & 3 times. */
+unsigned int transform_id(unsigned int id, int k)
+{
+	return rotate_id(k & 4 ? mirror_id(id) : id, k & 3);
+}
+
+/* Turns a segment mask a quarter clockwise rotation times. The centre
+ * stays put. */
+uint16_t rotate_segments(uint16_t segments, int rotation)
+{
+	const unsigned int r = 3 * (rotation & 3);
+	const unsigned int side = segments & 0xfff;
+	return ((side << r | side >> (12 - r)) & 0xfff) | (segments & CENTRE_BIT);
+}
+
+/* Writes the features of tile id, turned the way id is, to out. Returns
+ * how many there are. Every segment of a non empty tile is in exactly one
+ * feature, except the centre of a tile without a monastery or a city or
+ * road running through it. */
+unsigned int tile_features(unsigned int id, struct feature out[FEATURES_MAX])
+{
+	pthread_once(&tables_once, build_tables);
+	if (!id) {
+		return 0;
+	}
+	const unsigned int k = ID_KIND(id);
+	for (unsigned int i = 0; i < feature_counts[k]; ++i) {
+		out[i].segments = rotate_segments(features[k][i].segments,
+			ID_ROTATION(id));
+		out[i].kind = features[k][i].kind;
+		out[i].borders = features[k][i].borders;
+	}
+	return feature_counts[k];
+}
+
+/* Returns the canonical ids that fit sig and sets *n to how many. */
+const uint8_t *signature_fits(unsigned int sig, size_t *n)
+{
+	pthread_once(&tables_once, build_tables);
+	*n = fit_start[sig + 1] - fit_start[sig];
+	return fit_ids + fit_start[sig];
+}
+
+/* Returns the signatures some rotation of kind fits and sets *n to how
+ * many. */
+const uint8_t *kind_signatures(unsigned int kind, size_t *n)
+{
+	pthread_once(&tables_once, build_tables);
+	*n = kind_start[kind + 1] - kind_start[kind];
+	return kind_sigs + kind_start[kind];
+}
+
+/* The kinds of every tile in the deck, catalog order, so the start tile's
+ * first (see START_KIND). TILE_COUNT of them, constant. */
+const uint8_t *deck_template(void)
+{
+	return deck_kinds;
+}
+
+/* How many tiles of a whole deck fit each signature, some way round: what
+ * board_add_tiles() comes to for every kind's kind_count(). */
+const uint16_t *deck_fills(void)
+{
+	pthread_once(&tables_once, build_tables);
+	return deck_fits;
 }
 
 char *print_tile(const struct tile t, char b[TILE_LEN])
@@ -2,43 +2,97 @@
 #define TILE_H_
 
 #include <stdio.h>
+#include <stdint.h>	/* uint16_t */
 #include <stdlib.h>	/* malloc() */
 #include <string.h>	/* memcpy() */
+#include <pthread.h>	/* pthread_once() */
 #include "edge.h"	/* edges. */
 
 #define TILE_LINE_LEN 4
 #define TILE_LINES 3
 #define TILE_LEN TILE_LINE_LEN * TILE_LINES + 1 /* Null terminator */
 
-<<<<<<< HEAD
-<<<<<<< HEAD
-=======
-enum attribute {
-	NONE = 0,
-	SHIELD = 1,
-	DEN = 2
-};
-
->>>>>>> origin/dev
-=======
 enum attribute {
 	NONE = 0,
 	SHIELD = 1,
 	MONASTERY = 2
 };
 
->>>>>>> Nick495/dev
 struct tile {
 	enum edge edges[5]; /* Top, Right, Bottom, Left, Center. */
 	enum attribute attribute;
 };
 
-<<<<<<< HEAD
-=======
+/* Packed tiles are what the board stores: 2 bits per edge in the same
+ * order as struct tile, then 2 bits of attribute. EMPTY packs to 0. */
+#define PACKED_EDGE(p, i) ((enum edge) (((p) >> (2 * (i))) & 3))
+#define PACKED_ATTRIBUTE(p) ((enum attribute) (((p) >> 10) & 3))
+
+/* The catalog holds every distinct tile kind in the deck. A tile id names
+ * one kind in one rotation; id 0 is the empty tile. Rotations that look
+ * the same (symmetric tiles) share the lowest id, so ids compare equal
+ * exactly when the tiles do. */
+#define TILE_KINDS 24
+#define TILE_IDS (4 * TILE_KINDS + 1)
+#define START_KIND 0
+#define KIND_ID(k) (4 * (k) + 1)		/* Unrotated id of kind k. */
+#define ID_KIND(id) (((id) - 1) / 4)
+#define ID_ROTATION(id) (((id) - 1) % 4)
+
+/* A signature is what an empty slot's neighbours show it, packed like the
+ * sides of a tile: 2 bits per side, 0 where there's no neighbour. */
+#define SIGNATURES 256
+
+/* Rotations and reflections of the board, see transform_id(). */
+#define SYMMETRIES 8
+
+/* Segments split each side in 3, numbered clockwise from the top's left
+ * end (side d, part k is 3 * d + k), so turning a tile turns its segment
+ * masks 3 bits. A road has its middle part and fields the other two. The
+ * centre is the last segment. */
+#define SEGMENTS 13
+#define CENTRE_SEGMENT 12
+#define CENTRE_BIT (1 << CENTRE_SEGMENT)
+/* The segment of the neighbour across side segment s that touches s. */
+#define SEGMENT_ACROSS(s) (3 * ((s) / 3 + 2) % 12 + 2 - (s) % 3)
+#define FEATURES_MAX 8 /* The crossroads: 4 roads and 4 fields. */
+
+/* Cities, fields and roads share their edge's value. */
+enum feature_kind {
+	FEATURE_CITY = CITY,
+	FEATURE_FIELD = FIELD,
+	FEATURE_ROAD = ROAD,
+	FEATURE_MONASTERY = 4
+};
+
+/* One connected city, field, road or monastery on a tile. */
+struct feature {
+	uint16_t segments;
+	enum feature_kind kind;
+	uint8_t borders; /* Fields: bit i for each city feature i they touch. */
+};
+
 int tile_eq(struct tile a, struct tile b);
->>>>>>> Nick495/dev
 struct tile make_tile(const enum edge edges[5], enum attribute a);
 struct tile rotate_tile(const struct tile old, const int rotation);
+uint16_t pack_tile(struct tile t);
+struct tile unpack_tile(uint16_t p);
+uint16_t rotate_packed(uint16_t p, int rotation);
+unsigned int tile_to_id(struct tile t);
+struct tile id_to_tile(unsigned int id);
+uint16_t id_packed(unsigned int id);
+unsigned int rotate_id(unsigned int id, int rotation);
+unsigned int kind_count(unsigned int kind);
+const uint8_t *kind_counts(void);
+int id_fits(unsigned int id, unsigned int sig);
+const uint8_t *signature_fits(unsigned int sig, size_t *n);
+const uint8_t *kind_signatures(unsigned int kind, size_t *n);
+const uint8_t *deck_template(void);
+const uint16_t *deck_fills(void);
+unsigned int mirror_id(unsigned int id);
+unsigned int transform_id(unsigned int id, int k);
+uint16_t rotate_segments(uint16_t segments, int rotation);
+unsigned int tile_features(unsigned int id, struct feature out[FEATURES_MAX]);
 char *print_tile(struct tile t, char b[TILE_LEN]);
 
 #endif